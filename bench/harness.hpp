@@ -0,0 +1,214 @@
+#pragma once
+
+// Minimal self-contained benchmark harness.
+// Each benchmark does its setup and then hands the hot loop to State::measure,
+// the harness picks the iteration count and reports the results as JSON.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench
+{
+    // keep the compiler from discarding a computed value
+    template <typename T>
+    inline void do_not_optimize(T&& value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const void* sink;
+        sink = &value;
+#endif
+    }
+
+    class State
+    {
+    public:
+        explicit State(size_t iterations) : _iterations(iterations) {}
+
+        size_t iterations() const noexcept { return _iterations; }
+
+        // number of items processed per iteration, reported as items_per_second
+        void set_items_per_iteration(size_t items) noexcept { _items = items; }
+        size_t items_per_iteration() const noexcept { return _items; }
+
+        // run `body` iterations() times and record the elapsed time
+        template <typename F>
+        void measure(F&& body)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < _iterations; ++i)
+            {
+                body();
+            }
+            _elapsed = std::chrono::steady_clock::now() - start;
+            _measured = true;
+        }
+
+        std::chrono::nanoseconds elapsed() const noexcept { return _elapsed; }
+        bool measured() const noexcept { return _measured; }
+
+    private:
+        size_t _iterations;
+        size_t _items{0};
+        std::chrono::nanoseconds _elapsed{0};
+        bool _measured{false};
+    };
+
+    struct Options
+    {
+        std::chrono::milliseconds min_time{200};
+        size_t repetitions{3};
+        std::string filter;
+    };
+
+    struct Result
+    {
+        std::string name;
+        size_t iterations{0};
+        double ns_per_op{0};     // mean over repetitions
+        double min_ns_per_op{0}; // best repetition
+        double items_per_second{0};
+    };
+
+    class Registry
+    {
+    public:
+        static Registry& instance()
+        {
+            static Registry registry;
+            return registry;
+        }
+
+        void add(std::string name, std::function<void(State&)> fn)
+        {
+            _benchmarks.emplace_back(std::move(name), std::move(fn));
+        }
+
+        std::vector<Result> run(const Options& options) const
+        {
+            std::vector<Result> results;
+            for (const auto& [name, fn] : _benchmarks)
+            {
+                if (!options.filter.empty() && name.find(options.filter) == std::string::npos)
+                    continue;
+                std::fprintf(stderr, "%s...\n", name.c_str());
+                results.push_back(run_one(name, fn, options));
+            }
+            return results;
+        }
+
+    private:
+        static Result run_one(const std::string& name, const std::function<void(State&)>& fn, const Options& options)
+        {
+            using namespace std::chrono;
+            const auto target = duration_cast<nanoseconds>(options.min_time);
+
+            // grow the iteration count until one run takes a measurable share of the target time
+            size_t iterations = 1;
+            for (;;)
+            {
+                State state(iterations);
+                fn(state);
+                auto elapsed = state.elapsed();
+                if (elapsed >= target / 10 || iterations >= (size_t(1) << 30))
+                {
+                    double per_op = double(std::max<int64_t>(elapsed.count(), 1)) / double(iterations);
+                    iterations = std::max<size_t>(1, size_t(double(target.count()) / per_op));
+                    break;
+                }
+                iterations *= 10;
+            }
+
+            Result result;
+            result.name = name;
+            result.iterations = iterations;
+            result.min_ns_per_op = -1;
+            double total = 0;
+            size_t items = 0;
+            for (size_t rep = 0; rep < std::max<size_t>(1, options.repetitions); ++rep)
+            {
+                State state(iterations);
+                fn(state);
+                double per_op = double(state.elapsed().count()) / double(iterations);
+                total += per_op;
+                if (result.min_ns_per_op < 0 || per_op < result.min_ns_per_op)
+                    result.min_ns_per_op = per_op;
+                items = state.items_per_iteration();
+            }
+            result.ns_per_op = total / double(std::max<size_t>(1, options.repetitions));
+            if (items > 0 && result.ns_per_op > 0)
+                result.items_per_second = double(items) * 1e9 / result.ns_per_op;
+            return result;
+        }
+
+        std::vector<std::pair<std::string, std::function<void(State&)>>> _benchmarks;
+    };
+
+    struct Registrar
+    {
+        Registrar(std::string name, std::function<void(State&)> fn)
+        {
+            Registry::instance().add(std::move(name), std::move(fn));
+        }
+    };
+
+    inline std::string escape_json(const std::string& s)
+    {
+        std::string out;
+        out.reserve(s.size());
+        for (char c : s)
+        {
+            switch (c)
+            {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            default: out += c; break;
+            }
+        }
+        return out;
+    }
+
+    inline void write_json(std::FILE* out, const Options& options, const std::vector<Result>& results)
+    {
+        std::time_t now = std::time(nullptr);
+        char date[32] = {};
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+        std::fprintf(out, "{\n  \"context\": {\n");
+        std::fprintf(out, "    \"date\": \"%s\",\n", date);
+#ifdef NDEBUG
+        std::fprintf(out, "    \"build_type\": \"release\",\n");
+#else
+        std::fprintf(out, "    \"build_type\": \"debug\",\n");
+#endif
+        std::fprintf(out, "    \"min_time_ms\": %lld,\n", static_cast<long long>(options.min_time.count()));
+        std::fprintf(out, "    \"repetitions\": %zu\n  },\n", options.repetitions);
+        std::fprintf(out, "  \"benchmarks\": [\n");
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result& r = results[i];
+            std::fprintf(out,
+                         "    {\"name\": \"%s\", \"iterations\": %zu, \"ns_per_op\": %.2f, \"min_ns_per_op\": %.2f, "
+                         "\"items_per_second\": %.2f}%s\n",
+                         escape_json(r.name).c_str(), r.iterations, r.ns_per_op, r.min_ns_per_op, r.items_per_second,
+                         i + 1 < results.size() ? "," : "");
+        }
+        std::fprintf(out, "  ]\n}\n");
+    }
+}
+
+#define BENCH_CONCAT_IMPL(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_IMPL(a, b)
+
+// register a benchmark: BENCHMARK("group/name", [](bench::State& state) { ... });
+#define BENCHMARK(name, ...) static ::bench::Registrar BENCH_CONCAT(_bench_registrar_, __LINE__)(name, __VA_ARGS__)
@@ -0,0 +1,413 @@
+#include "harness.hpp"
+
+#include <quickjs/quickjs.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+    int32_t add(int32_t a, int32_t b)
+    {
+        return a + b;
+    }
+
+    std::string echo(const std::string& s)
+    {
+        return s;
+    }
+
+    template <typename T>
+    std::vector<T> make_vector(size_t size)
+    {
+        std::vector<T> values(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            if constexpr (std::is_same_v<T, std::string>)
+                values[i] = "item" + std::to_string(i);
+            else
+                values[i] = static_cast<T>(i);
+        }
+        return values;
+    }
+
+    // source data for the to_js benchmarks (returned by value, so the copy is part of the measurement)
+    template <typename T>
+    std::vector<T>& source()
+    {
+        static std::vector<T> values;
+        return values;
+    }
+
+    template <typename T>
+    std::vector<T> produce()
+    {
+        return source<T>();
+    }
+
+    template <typename T>
+    js::typed_array<T> produce_typed()
+    {
+        return js::typed_array<T>(source<T>());
+    }
+
+    template <typename T>
+    uint32_t consume(std::vector<T> values)
+    {
+        return static_cast<uint32_t>(values.size());
+    }
+
+    template <typename T>
+    uint32_t consume_span(js::span<const T> values)
+    {
+        return static_cast<uint32_t>(values.size());
+    }
+
+    bool has_value(std::optional<int32_t> value)
+    {
+        return value.has_value();
+    }
+
+    class Point
+    {
+    public:
+        int32_t x = 1;
+        double y = 2.5;
+
+        int32_t scale(int32_t factor)
+        {
+            return x * factor;
+        }
+    };
+
+    // runtime + context with the "bench" module imported into globalThis.bench.
+    // Converters are measured through bound functions, the same path user bindings take.
+    struct Fixture
+    {
+        js::Runtime runtime;
+        js::Context context{runtime};
+
+        Fixture()
+        {
+            js::Module& module = context.add_module("bench")
+                                     .function<&add>("add")
+                                     .function<&echo>("echo")
+                                     .function<&has_value>("hasValue")
+                                     .function<&produce<int32_t>>("produce_int32_t")
+                                     .function<&produce<double>>("produce_double")
+                                     .function<&produce<std::string>>("produce_string")
+                                     .function<&produce_typed<int32_t>>("produce_typed_int32_t")
+                                     .function<&produce_typed<double>>("produce_typed_double")
+                                     .function<&consume<int32_t>>("consume_int32_t")
+                                     .function<&consume<double>>("consume_double")
+                                     .function<&consume<std::string>>("consume_string")
+                                     .function<&consume_span<int32_t>>("consume_span_int32_t")
+                                     .function<&consume_span<double>>("consume_span_double");
+            module.add_class<Point>("Point")
+                .constructor<>()
+                .function<&Point::x>("x")
+                .function<&Point::y>("y")
+                .function<&Point::scale>("scale");
+
+            context.eval("import * as bench from 'bench'; globalThis.bench = bench;", "<bench>",
+                         js::JSEvalOptions::TYPE_MODULE);
+        }
+    };
+
+    std::string large_script()
+    {
+        std::string code;
+        for (int i = 0; i < 2000; ++i)
+        {
+            code += "function f" + std::to_string(i) + "(x) { return x * " + std::to_string(i) + " + " +
+                    std::to_string(i % 7) + "; }\n";
+        }
+        code += "f1999(2);\n";
+        return code;
+    }
+
+    // call `fn` with `args` for every iteration
+    void measure_call(bench::State& state, const js::Value& fn, const std::vector<js::Value>& args = {})
+    {
+        state.measure([&] { bench::do_not_optimize(fn.call(args)); });
+    }
+
+    template <typename T>
+    void register_vector_benchmarks(const std::string& type_name)
+    {
+        for (size_t size : {size_t(10), size_t(1000), size_t(1000000)})
+        {
+            const std::string suffix = "/" + std::to_string(size);
+            const std::string array_code = "Array.from({length: " + std::to_string(size) + "}, (_, i) => " +
+                                           (std::is_same_v<T, std::string> ? "'item' + i" : "i") + ")";
+
+            bench::Registry::instance().add("converter/vector<" + type_name + ">/to_js" + suffix,
+                                            [size, type_name](bench::State& state)
+                                            {
+                                                Fixture fixture;
+                                                source<T>() = make_vector<T>(size);
+                                                state.set_items_per_iteration(size);
+                                                measure_call(state, fixture.context.eval("bench.produce_" + type_name));
+                                            });
+
+            bench::Registry::instance().add("converter/vector<" + type_name + ">/from_js" + suffix,
+                                            [size, type_name, array_code](bench::State& state)
+                                            {
+                                                Fixture fixture;
+                                                std::vector<js::Value> args{fixture.context.eval(array_code)};
+                                                state.set_items_per_iteration(size);
+                                                measure_call(state, fixture.context.eval("bench.consume_" + type_name), args);
+                                            });
+
+            if constexpr (js::detail::is_typed_array_element_v<T>)
+            {
+                const std::string typed_code = std::string(std::is_same_v<T, double> ? "Float64Array" : "Int32Array") +
+                                               ".from(" + array_code + ")";
+
+                bench::Registry::instance().add("converter/typed_array<" + type_name + ">/to_js" + suffix,
+                                                [size, type_name](bench::State& state)
+                                                {
+                                                    Fixture fixture;
+                                                    source<T>() = make_vector<T>(size);
+                                                    state.set_items_per_iteration(size);
+                                                    measure_call(state, fixture.context.eval("bench.produce_typed_" + type_name));
+                                                });
+
+                bench::Registry::instance().add("converter/vector<" + type_name + ">/from_js/typed_array" + suffix,
+                                                [size, type_name, typed_code](bench::State& state)
+                                                {
+                                                    Fixture fixture;
+                                                    std::vector<js::Value> args{fixture.context.eval(typed_code)};
+                                                    state.set_items_per_iteration(size);
+                                                    measure_call(state, fixture.context.eval("bench.consume_" + type_name), args);
+                                                });
+
+                bench::Registry::instance().add("converter/span<" + type_name + ">/from_js" + suffix,
+                                                [size, type_name, typed_code](bench::State& state)
+                                                {
+                                                    Fixture fixture;
+                                                    std::vector<js::Value> args{fixture.context.eval(typed_code)};
+                                                    state.set_items_per_iteration(size);
+                                                    measure_call(state, fixture.context.eval("bench.consume_span_" + type_name), args);
+                                                });
+            }
+        }
+    }
+
+    void register_call_benchmark(size_t argc)
+    {
+        bench::Registry::instance().add("value/call/" + std::to_string(argc) + "_args",
+                                        [argc](bench::State& state)
+                                        {
+                                            Fixture fixture;
+                                            js::Value fn = fixture.context.eval("(function (...args) { return args.length; })");
+                                            std::vector<js::Value> args;
+                                            for (size_t i = 0; i < argc; ++i)
+                                                args.push_back(fixture.context.eval(std::to_string(i)));
+                                            measure_call(state, fn, args);
+                                        });
+    }
+}
+
+// Context::eval
+
+BENCHMARK("eval/small",
+          [](bench::State& state)
+          {
+              js::Runtime runtime;
+              js::Context context(runtime);
+              state.measure([&] { bench::do_not_optimize(context.eval("1 + 2")); });
+          });
+
+BENCHMARK("eval/large",
+          [](bench::State& state)
+          {
+              js::Runtime runtime;
+              js::Context context(runtime);
+              const std::string code = large_script();
+              state.measure([&] { bench::do_not_optimize(context.eval(code)); });
+          });
+
+BENCHMARK("eval/large/bytecode_cache",
+          [](bench::State& state)
+          {
+              js::Runtime runtime;
+              js::Context context(runtime);
+              context.enable_bytecode_cache(std::make_shared<js::BytecodeCache>());
+              const std::string code = large_script();
+              state.measure([&] { bench::do_not_optimize(context.eval(code)); });
+          });
+
+// Value::call
+
+static const bool call_benchmarks = []
+{
+    for (size_t argc : {size_t(0), size_t(4), size_t(16)})
+        register_call_benchmark(argc);
+    return true;
+}();
+
+BENCHMARK("value/call/4_args/variadic",
+          [](bench::State& state)
+          {
+              Fixture fixture;
+              js::Value fn = fixture.context.eval("(function (...args) { return args.length; })");
+              state.measure([&] { bench::do_not_optimize(fn.call(0, 1, 2, 3)); });
+          });
+
+BENCHMARK("function/call/4_args",
+          [](bench::State& state)
+          {
+              Fixture fixture;
+              js::Function<int32_t(int32_t, int32_t, int32_t, int32_t)> fn(
+                  fixture.context.eval("(function (a, b, c, d) { return a + b + c + d; })"));
+              state.measure([&] { bench::do_not_optimize(fn(0, 1, 2, 3)); });
+          });
+
+// FreeFunctionWrapper / MemberFunctionWrapper / MemberPropertyWrapper round trips
+
+BENCHMARK("wrapper/free_function",
+          [](bench::State& state)
+          {
+              Fixture fixture;
+              measure_call(state, fixture.context.eval("bench.add"), {fixture.context.eval("1"), fixture.context.eval("2")});
+          });
+
+BENCHMARK("wrapper/member_function",
+          [](bench::State& state)
+          {
+              Fixture fixture;
+              js::Value obj = fixture.context.eval("new bench.Point()");
+              js::Value fn = obj["scale"];
+              std::vector<js::Value> args{fixture.context.eval("3")};
+              state.measure([&] { bench::do_not_optimize(fn.call_with_this(obj, args)); });
+          });
+
+BENCHMARK("wrapper/property/get",
+          [](bench::State& state)
+          {
+              Fixture fixture;
+              js::Value obj = fixture.context.eval("new bench.Point()");
+              state.measure([&] { bench::do_not_optimize(obj["x"]); });
+          });
+
+BENCHMARK("wrapper/property/set",
+          [](bench::State& state)
+          {
+              Fixture fixture;
+              measure_call(state, fixture.context.eval("(function (p) { p.x = 7; })"),
+                           {fixture.context.eval("new bench.Point()")});
+          });
+
+// TypeConverter
+
+BENCHMARK("converter/string/round_trip",
+          [](bench::State& state)
+          {
+              Fixture fixture;
+              measure_call(state, fixture.context.eval("bench.echo"),
+                           {fixture.context.eval("'a moderately sized string for the converter benchmark'")});
+          });
+
+BENCHMARK("converter/optional<int32_t>/from_js",
+          [](bench::State& state)
+          {
+              Fixture fixture;
+              js::Value fn = fixture.context.eval("bench.hasValue");
+              std::vector<js::Value> some{fixture.context.eval("42")};
+              std::vector<js::Value> none{fixture.context.eval("null")};
+              size_t i = 0;
+              state.measure([&] { bench::do_not_optimize(fn.call((i++ & 1) ? some : none)); });
+          });
+
+static const bool vector_benchmarks = []
+{
+    register_vector_benchmarks<int32_t>("int32_t");
+    register_vector_benchmarks<double>("double");
+    register_vector_benchmarks<std::string>("string");
+    return true;
+}();
+
+// Runtime / Context construction
+
+BENCHMARK("runtime/construct",
+          [](bench::State& state)
+          {
+              state.measure(
+                  []
+                  {
+                      js::Runtime runtime;
+                      bench::do_not_optimize(runtime);
+                  });
+          });
+
+BENCHMARK("context/construct",
+          [](bench::State& state)
+          {
+              js::Runtime runtime;
+              state.measure(
+                  [&]
+                  {
+                      js::Context context(runtime);
+                      bench::do_not_optimize(context);
+                  });
+          });
+
+int main(int argc, char** argv)
+{
+    bench::Options options;
+    const char* out_path = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        if (std::strncmp(arg, "--filter=", 9) == 0)
+            options.filter = arg + 9;
+        else if (std::strncmp(arg, "--min-time=", 11) == 0)
+            options.min_time = std::chrono::milliseconds(std::atoll(arg + 11));
+        else if (std::strncmp(arg, "--repetitions=", 14) == 0)
+            options.repetitions = static_cast<size_t>(std::atoll(arg + 14));
+        else if (std::strncmp(arg, "--out=", 6) == 0)
+            out_path = arg + 6;
+        else
+        {
+            std::fprintf(stderr,
+                         "usage: %s [--filter=substring] [--min-time=ms] [--repetitions=n] [--out=file.json]\n",
+                         argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<bench::Result> results;
+    try
+    {
+        results = bench::Registry::instance().run(options);
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "benchmark failed: %s\n", e.what());
+        return 1;
+    }
+
+    std::FILE* out = stdout;
+    if (out_path)
+    {
+        out = std::fopen(out_path, "w");
+        if (!out)
+        {
+            std::fprintf(stderr, "cannot open %s\n", out_path);
+            return 1;
+        }
+    }
+    bench::write_json(out, options, results);
+    if (out != stdout)
+        std::fclose(out);
+    return 0;
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <quickjs.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace js
+{
+    // Memory source for a Runtime (see Runtime::Runtime(std::unique_ptr<Allocator>)).
+    // Blocks are sized on deallocation, so implementations need no per-block bookkeeping.
+    // Every block must be aligned to alignof(std::max_align_t).
+    // A runtime is used by one thread at a time, so allocators need not be thread-safe.
+    class Allocator
+    {
+    public:
+        virtual ~Allocator() = default;
+
+        virtual void* allocate(size_t size) noexcept = 0;
+        virtual void deallocate(void* ptr, size_t size) noexcept = 0;
+
+        // the default implementation allocates a new block and copies
+        virtual void* reallocate(void* ptr, size_t old_size, size_t new_size) noexcept;
+
+        // the QuickJS malloc hooks forwarding to an Allocator passed as opaque
+        static const JSMallocFunctions& malloc_functions() noexcept;
+    };
+
+    // Size-class free-list allocator. Small blocks are carved out of 64 KiB chunks and recycled
+    // through per-class free lists without locking; larger blocks fall back to malloc.
+    // All chunks are released when the allocator is destroyed.
+    class PoolAllocator final : public Allocator
+    {
+    public:
+        static constexpr size_t MAX_POOLED_SIZE = 1024;
+        static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+        PoolAllocator() = default;
+        ~PoolAllocator() override;
+
+        PoolAllocator(const PoolAllocator&) = delete;
+        PoolAllocator& operator=(const PoolAllocator&) = delete;
+
+        void* allocate(size_t size) noexcept override;
+        void deallocate(void* ptr, size_t size) noexcept override;
+        void* reallocate(void* ptr, size_t old_size, size_t new_size) noexcept override;
+
+    private:
+        struct FreeBlock
+        {
+            FreeBlock* next;
+        };
+
+        static constexpr size_t CLASS_GRANULARITY = 16;
+        static constexpr size_t CLASS_COUNT = MAX_POOLED_SIZE / CLASS_GRANULARITY;
+
+        static size_t class_index(size_t size) noexcept { return (size - 1) / CLASS_GRANULARITY; }
+        static size_t class_size(size_t index) noexcept { return (index + 1) * CLASS_GRANULARITY; }
+
+        void* refill(size_t index) noexcept;
+
+    private:
+        std::array<FreeBlock*, CLASS_COUNT> _free{};
+        std::vector<void*> _chunks;
+        uint8_t* _cursor{nullptr};
+        uint8_t* _limit{nullptr};
+    };
+
+    // Bump allocator for short-lived runtimes. Freed blocks are not reused (except the most
+    // recent one); all memory is returned at once when the allocator is destroyed, i.e. after
+    // the owning Runtime has been torn down.
+    class ArenaAllocator final : public Allocator
+    {
+    public:
+        explicit ArenaAllocator(size_t chunk_size = 256 * 1024) noexcept;
+        ~ArenaAllocator() override;
+
+        ArenaAllocator(const ArenaAllocator&) = delete;
+        ArenaAllocator& operator=(const ArenaAllocator&) = delete;
+
+        void* allocate(size_t size) noexcept override;
+        void deallocate(void* ptr, size_t size) noexcept override;
+        void* reallocate(void* ptr, size_t old_size, size_t new_size) noexcept override;
+
+        // bytes reserved from the system
+        size_t reserved() const noexcept { return _reserved; }
+
+    private:
+        size_t _chunk_size;
+        size_t _reserved{0};
+        std::vector<void*> _chunks;
+        uint8_t* _cursor{nullptr};
+        uint8_t* _limit{nullptr};
+        uint8_t* _last{nullptr}; // most recent bump allocation
+    };
+
+    // Fixed-size block pool for the C++ objects of one bound class in one runtime (see ClassBuilder::pooled).
+    // Slabs come from the runtime allocator, so they count toward its memory limit and GC threshold. A slab
+    // is a run of granules aligned to their own size, each starting with a header line that points back at
+    // the pool, so given the granule size a block finds its pool from its address alone; blocks of up to a
+    // cache line never straddle two lines. Freed blocks are recycled through a free list. Not thread-safe.
+    class ObjectPool
+    {
+    public:
+        static constexpr size_t CACHE_LINE = 64;
+        static constexpr size_t MIN_GRANULE = 4096;
+
+        ObjectPool(JSRuntime* rt, size_t object_size, size_t object_alignment, size_t blocks_per_slab);
+        ~ObjectPool();
+
+        ObjectPool(const ObjectPool&) = delete;
+        ObjectPool& operator=(const ObjectPool&) = delete;
+
+        // nullptr when out of memory or draining
+        void* allocate() noexcept;
+
+        // return a block to the pool that allocated it, `granule_size` is the granule_size() of that pool
+        static void release(void* block, size_t granule_size) noexcept;
+
+        // stop allocating and return each slab to the runtime as soon as its last block is released.
+        // Called before the runtime is freed, whose finalizers release the remaining blocks.
+        void drain() noexcept;
+
+        // layout of a pool, computed the same way by the constructor. Neither depends on the slab capacity.
+        static size_t block_size_for(size_t object_size, size_t object_alignment) noexcept;
+        static size_t granule_size_for(size_t object_size, size_t object_alignment) noexcept;
+
+        size_t block_size() const noexcept { return _block_size; }
+        size_t granule_size() const noexcept { return _granule_size; }
+        size_t slab_count() const noexcept { return _slabs.size(); }
+        size_t live_count() const noexcept { return _live; }
+
+    private:
+        struct FreeBlock
+        {
+            FreeBlock* next;
+        };
+
+        // first cache line of every granule, `memory` and `live` are only kept in the first granule of a slab
+        struct alignas(CACHE_LINE) SlabHeader
+        {
+            ObjectPool* pool;
+            SlabHeader* slab; // first granule of the slab
+            void* memory;     // as returned by js_malloc_rt
+            size_t live;      // blocks of the slab in use
+        };
+
+        static SlabHeader* header_of(void* block, size_t granule_size) noexcept
+        {
+            return reinterpret_cast<SlabHeader*>(reinterpret_cast<uintptr_t>(block) & ~(uintptr_t(granule_size) - 1));
+        }
+
+        bool grow() noexcept;
+        void free_slab(SlabHeader* slab) noexcept;
+
+    private:
+        JSRuntime* _runtime;
+        size_t _block_size;
+        size_t _granule_size; // power of two, granules are aligned to it
+        size_t _granules_per_slab;
+        std::vector<SlabHeader*> _slabs;
+        FreeBlock* _free{nullptr};
+        uint8_t* _cursor{nullptr};
+        uint8_t* _limit{nullptr};    // end of the current granule
+        uint8_t* _slab_end{nullptr}; // end of the current slab
+        size_t _live{0};
+        bool _draining{false};
+    };
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "macros.hpp"
+#include "bytecode_cache.hpp"
+#include "promise.hpp"
 #include "runtime.hpp"
 #include "value.hpp"
 
@@ -8,10 +10,12 @@
 #include <quickjs-libc.h>
 #include <quickjs.h>
 
+#include <deque>
 #include <string>
 #include <vector>
 
 #include <functional>
+#include <memory>
 
 namespace js
 {
@@ -34,9 +38,18 @@ namespace js
     JSEvalOptions operator&(JSEvalOptions lhs, JSEvalOptions rhs) noexcept;
 
     class Module;
+    class ModuleDefinition;
+    enum class ModuleLoading : int32_t;
+    class BundleWriter;
+    class EventLoop;
+    class Executor;
 
     class Context
     {
+        friend class BundleWriter;
+        friend class EventLoop;
+        friend class Executor;
+
     public:
         Context();
         explicit Context(Runtime& runtime);
@@ -54,12 +67,39 @@ namespace js
         // evaluate js code
         Value eval(const std::string& code, const std::string& filename = "<eval>", JSEvalOptions flags = JSEvalOptions::TYPE_GLOBAL | JSEvalOptions::FLAG_STRICT) QUICKJS_MAYBE_NOEXCEPT;
 
+        // evaluate js code within an execution budget, throws InterruptedException when it runs out
+        Value eval(const std::string& code, const std::string& filename, JSEvalOptions flags, const ExecutionBudget& budget) QUICKJS_MAYBE_NOEXCEPT;
+
+        // evaluate js code asynchronously (top-level await allowed), the returned promise settles as pending jobs run.
+        // For global scripts it resolves to the completion value of the script.
+        Promise eval_async(const std::string& code, const std::string& filename = "<eval>", JSEvalOptions flags = JSEvalOptions::TYPE_GLOBAL | JSEvalOptions::FLAG_STRICT) QUICKJS_MAYBE_NOEXCEPT;
+
+        // run up to `max_jobs` pending jobs (promise reactions, async continuations) of the runtime, 0 runs until the
+        // queue is empty. returns the number of jobs executed.
+        size_t run_pending_jobs(size_t max_jobs = 0) QUICKJS_MAYBE_NOEXCEPT;
+
+        // check if the runtime has pending jobs
+        bool has_pending_jobs() const noexcept;
+
+        // create a JS promise that is settled from C++
+        PromiseResolver new_promise();
+
+        // load a bytecode bundle written by BundleWriter, the file is memory-mapped and its entries are
+        // instantiated in order straight from the mapping. The index is validated before anything runs; an entry
+        // that throws, including a module whose top-level code rejects, stops loading. returns the number of
+        // entries evaluated successfully.
+        size_t load_bundle(const std::string& path) QUICKJS_MAYBE_NOEXCEPT;
+
         // get global object of the current js context
         Value get_global() const;
 
         // get exception of the current js context
         Value get_exception() const;
 
+        // a new atom for `name`, released with the returned Atom. Names fixed at compile time are
+        // better spelled QUICKJS_ATOM("name"), which is resolved once per runtime
+        Atom atom(const std::string& name) const;
+
         // add a variable to global object
         template <typename T>
         Context& add_variable(const std::string& name, T value)
@@ -85,6 +125,13 @@ namespace js
         // add a module to the current js context
         Module& add_module(const std::string& name);
 
+        // add a module whose exports are created as selected by `loading`, ModuleLoading::LAZY defers
+        // creating them until a script first imports the module
+        Module& add_module(const std::string& name, ModuleLoading loading);
+
+        // instantiate a module definition shared between contexts, the definition is kept alive by the context
+        Module& add_module(std::shared_ptr<const ModuleDefinition> definition);
+
         // import os module
         // Note: This library provides some low-level control functions.
         // Please import and use it with caution.
@@ -101,14 +148,40 @@ namespace js
         // set the callback function to be invoked on exception.
         void set_exception_callback(std::function<void(JSContext*)> callback = process_exception) { _on_exception = callback; }
 
+        // enable the bytecode cache for eval(), global scripts are compiled once and replayed from bytecode afterwards.
+        // The cache may be shared between contexts.
+        void enable_bytecode_cache(std::shared_ptr<BytecodeCache> cache = std::make_shared<BytecodeCache>());
+
+        // disable the bytecode cache, the hit/miss counters are kept
+        void disable_bytecode_cache() noexcept;
+
+        // get the bytecode cache in use (nullptr if disabled)
+        const std::shared_ptr<BytecodeCache>& bytecode_cache() const noexcept { return _bytecode_cache; }
+
+        // bytecode cache statistics of this context
+        uint64_t bytecode_cache_hits() const noexcept { return _bytecode_cache_hits; }
+        uint64_t bytecode_cache_misses() const noexcept { return _bytecode_cache_misses; }
+
     private:
         static void process_exception(JSContext* ctx);
 
+        // evaluate `code`, through the bytecode cache when enabled, returns the raw eval result
+        JSValue eval_raw(const std::string& code, const std::string& filename, int32_t flags);
+
+        // compile `code` through the bytecode cache and run it, returns the raw eval result
+        JSValue eval_cached(const std::string& code, const std::string& filename, int32_t flags);
+
+        // wrap the raw eval result, reporting the pending exception if any
+        Value make_eval_result(JSValue result, const std::string& filename) QUICKJS_MAYBE_NOEXCEPT;
+
         JSContext* get_context_handle() const noexcept { return _context; }
 
     private:
         JSContext* _context;
-        std::vector<Module> _modules;
+        std::deque<Module> _modules; // deque keeps references handed out by add_module valid
         std::function<void(JSContext*)> _on_exception{&process_exception};
+        std::shared_ptr<BytecodeCache> _bytecode_cache;
+        uint64_t _bytecode_cache_hits{0};
+        uint64_t _bytecode_cache_misses{0};
     };
 }
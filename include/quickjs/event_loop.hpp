@@ -0,0 +1,161 @@
+#pragma once
+
+#if defined(__linux__)
+
+#include "macros.hpp"
+#include "context.hpp"
+
+#include <quickjs.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace js
+{
+    namespace detail
+    {
+        // hierarchical timing wheel with 1 ms ticks: LEVELS wheels of SLOTS slots, each level covering
+        // SLOTS times the span of the one below it. Timers past the top level are parked there and
+        // cascade down again until they fall into range. Not thread-safe.
+        class TimerWheel
+        {
+        public:
+            static constexpr size_t SLOT_BITS = 6;
+            static constexpr size_t SLOTS = size_t(1) << SLOT_BITS;
+            static constexpr size_t LEVELS = 4;
+
+            explicit TimerWheel(uint64_t now_ms = 0) noexcept : _current(now_ms) {}
+
+            // schedule timer `id` to expire at `expires_ms`
+            void add(uint64_t id, uint64_t expires_ms);
+
+            // forget timer `id`, stale slot entries are skipped when they come up
+            bool cancel(uint64_t id);
+
+            // advance to `now_ms`, appending the ids of expired timers to `expired` in expiry order
+            void advance(uint64_t now_ms, std::vector<uint64_t>& expired);
+
+            // milliseconds until the wheel needs to advance again (-1 when there are no timers)
+            int64_t next_timeout() const;
+
+            size_t size() const noexcept { return _expiry.size(); }
+            bool empty() const noexcept { return _expiry.empty(); }
+            uint64_t current() const noexcept { return _current; }
+
+        private:
+            struct Entry
+            {
+                uint64_t id;
+                uint64_t expires;
+            };
+
+            void place(const Entry& entry);
+            void cascade(size_t level);
+
+        private:
+            std::array<std::array<std::vector<Entry>, SLOTS>, LEVELS> _wheels;
+            std::unordered_map<uint64_t, uint64_t> _expiry; // id -> expiry of live timers
+            uint64_t _current;
+        };
+    }
+
+    // single-threaded event loop on one epoll instance.
+    // It multiplexes the runtime's pending jobs, timers, fd readiness and callbacks posted from other threads.
+    // The loop installs setTimeout/clearTimeout/setInterval/clearInterval into the context and must be
+    // destroyed before the context. A JS timer callback that throws is reported through the context's
+    // exception callback and the loop keeps going; exceptions thrown by C++ callbacks propagate out of
+    // run()/run_once(). Timers of the quickjs-libc os module (os.setTimeout, os.setReadHandler) are only
+    // serviced by js_std_loop and are not driven by this loop.
+    class EventLoop
+    {
+    public:
+        using Callback = std::function<void()>;
+        using FdCallback = std::function<void(uint32_t events)>; // receives the ready EPOLL* events
+        using TimerId = uint64_t;
+
+        explicit EventLoop(Context& context);
+        ~EventLoop();
+
+        EventLoop(const EventLoop&) = delete;
+        EventLoop& operator=(const EventLoop&) = delete;
+
+        // run until stop() is called or nothing is left to wait for
+        void run() QUICKJS_MAYBE_NOEXCEPT;
+
+        // run one iteration, waiting at most `timeout` for events. returns false when nothing is left to wait for
+        bool run_once(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1)) QUICKJS_MAYBE_NOEXCEPT;
+
+        // epoll descriptor of the loop, for nesting it in another poller: it becomes readable when a timer is
+        // due, a watched fd is ready or a callback was posted; then call run_once(std::chrono::milliseconds(0))
+        int fd() const noexcept { return _epoll_fd; }
+
+        // make run() return after the current iteration, may be called from any thread
+        void stop() noexcept;
+
+        // queue `callback` to run on the loop thread, may be called from any thread
+        void post(Callback callback);
+
+        // host timers
+        TimerId set_timeout(std::chrono::milliseconds delay, Callback callback);
+        TimerId set_interval(std::chrono::milliseconds period, Callback callback);
+        bool clear_timer(TimerId id);
+
+        // watch `fd` for `events` (EPOLLIN, EPOLLOUT, ...), replacing an existing watch
+        bool watch_fd(int fd, uint32_t events, FdCallback callback);
+        bool unwatch_fd(int fd);
+
+        // check if any timers, fd watchers, posted callbacks or pending jobs remain
+        bool alive() const;
+
+        Context& context() noexcept { return _context; }
+
+    private:
+        struct Timer
+        {
+            std::shared_ptr<Callback> callback;
+            uint64_t period; // 0 for one-shot timers
+        };
+
+        static uint64_t now_ms() noexcept;
+
+        TimerId add_timer(uint64_t delay, uint64_t period, Callback callback);
+        void run_posted();
+        void run_timers();
+        void arm_timer_fd() noexcept;
+        void wake() noexcept;
+        void report_exception();
+
+        void install_timer_functions();
+        static JSValue set_js_timer(JSContext* ctx, int argc, JSValueConst* argv, bool repeat);
+        static JSValue js_set_timeout(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv);
+        static JSValue js_set_interval(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv);
+        static JSValue js_clear_timer(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv);
+
+    private:
+        Context& _context;
+        int _epoll_fd{-1};
+        int _wake_fd{-1};
+        int _timer_fd{-1}; // armed to the next timer deadline so fd() reports it
+        std::atomic<bool> _stopped{false};
+
+        detail::TimerWheel _wheel;
+        std::unordered_map<TimerId, Timer> _timers;
+        TimerId _next_timer_id{1};
+        std::vector<uint64_t> _expired;
+
+        std::unordered_map<int, std::shared_ptr<FdCallback>> _watchers;
+
+        mutable std::mutex _posted_mutex;
+        std::vector<Callback> _posted;
+    };
+}
+
+#endif
@@ -30,4 +30,11 @@ namespace js
     private:
         std::string _error_message;
     };
+
+    // thrown when a script is stopped because its ExecutionBudget ran out
+    class InterruptedException : public Exception
+    {
+    public:
+        using Exception::Exception;
+    };
 }
@@ -19,6 +19,15 @@
 #define QUICKJS_DEBUGBREAK()
 #endif
 
+// branch hints for hot paths
+#if defined(__GNUC__) || defined(__clang__)
+#define QUICKJS_LIKELY(x)   __builtin_expect(!!(x), 1)
+#define QUICKJS_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#define QUICKJS_LIKELY(x)   (x)
+#define QUICKJS_UNLIKELY(x) (x)
+#endif
+
 /*
 QUICKJS_MAYBE_NOEXCEPT
 When exceptions are enabled, this function may throw exceptions;
@@ -1,17 +1,37 @@
 #pragma once
 
+#include "macros.hpp"
+#include "utils.hpp"
 #include "type_converter.hpp"
 #include "type_traits.hpp"
 #include "exception.hpp"
+#include "atom.hpp"
+#include "runtime.hpp"
 
 #include <quickjs.h>
 
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <new>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace js
 {
     class Module;
+    class ModuleDefinition;
+
+    // when the exports of a module are created
+    enum class ModuleLoading : int32_t
+    {
+        EAGER, // export values are created while the module is built
+        LAZY   // only the export names are declared, values are created when the module is first imported
+    };
 
     namespace detail
     {
@@ -19,16 +39,238 @@ namespace js
         {
             std::string name;
             JSValue value;
+
+            // lazy exports: a C function created on import, or a factory returning a new value
+            JSCFunction* func{nullptr};
+            int length{0};
+            std::function<JSValue(JSContext*)> factory{};
         };
     }
 
     template <typename T>
     class ClassBuilder;
 
+    template <typename T>
+    class ClassTable;
+
+    namespace detail
+    {
+        template <auto Member>
+        struct MethodDescriptor
+        {
+            const char* name;
+        };
+
+        template <auto Member, bool Writable>
+        struct FieldDescriptor
+        {
+            const char* name;
+        };
+
+        // class id of T in the runtime of `ctx`, JS_INVALID_CLASS_ID when T is not registered there.
+        // The last successful lookup is cached per thread, keyed by the serial of the runtime's registry.
+        template <typename T>
+        JSClassID class_id_of(JSContext* ctx) noexcept
+        {
+            struct Slot
+            {
+                uint64_t serial;
+                JSClassID id;
+            };
+            static thread_local Slot slot{0, JS_INVALID_CLASS_ID};
+
+            RuntimeData* data = runtime_data(ctx);
+            if (QUICKJS_UNLIKELY(!data))
+            {
+                return JS_INVALID_CLASS_ID;
+            }
+            uint64_t serial = data->classes.serial();
+            if (QUICKJS_LIKELY(slot.serial == serial))
+            {
+                return slot.id;
+            }
+
+            const ClassEntry* entry = data->classes.find(ClassRegistry::type_index<T>());
+            JSClassID id = entry ? entry->id : JS_INVALID_CLASS_ID;
+            if (id != JS_INVALID_CLASS_ID)
+            {
+                slot = {serial, id};
+            }
+            return id;
+        }
+
+        // the T behind the opaque of an object of class `cid`, which is T itself or a class derived from it
+        template <typename T>
+        T* object_cast(const ClassRegistry& classes, JSClassID cid, void* opaque) noexcept
+        {
+            const ClassEntry* entry = classes.find(ClassRegistry::type_index<T>());
+            if (!entry)
+            {
+                return nullptr;
+            }
+            if (cid == entry->id)
+            {
+                return static_cast<T*>(opaque);
+            }
+            for (const DerivedClass& derived : entry->derived)
+            {
+                if (void* object = derived.cast(classes, cid, opaque))
+                {
+                    return static_cast<T*>(object);
+                }
+            }
+            return nullptr;
+        }
+
+        // the T bound to `value`, nullptr for any other value. Objects of exactly class T take a single compare,
+        // derived bound classes walk the (short) list of classes registered with ClassBuilder::inherits.
+        template <typename T>
+        T* unwrap_object(JSContext* ctx, JSValueConst value) noexcept
+        {
+            JSClassID cid = JS_GetClassID(value);
+            if (QUICKJS_UNLIKELY(cid == JS_INVALID_CLASS_ID))
+            {
+                return nullptr;
+            }
+            if (QUICKJS_LIKELY(cid == class_id_of<T>(ctx)))
+            {
+                return static_cast<T*>(JS_GetOpaque(value, cid));
+            }
+
+            RuntimeData* data = runtime_data(ctx);
+            const ClassEntry* entry = data ? data->classes.find(ClassRegistry::type_index<T>()) : nullptr;
+            if (!entry || entry->derived.empty())
+            {
+                return nullptr;
+            }
+            void* opaque = JS_GetOpaque(value, cid);
+            return opaque ? object_cast<T>(data->classes, cid, opaque) : nullptr;
+        }
+
+        // storage of bound C++ objects: one block holding the T itself, which is what the class opaque points at.
+        // Blocks come from the per-runtime ObjectPool of pooled classes, otherwise from the runtime allocator.
+        // Over-aligned types fall back to operator new.
+        template <typename T>
+        struct ObjectStorage
+        {
+            static constexpr bool runtime_allocated = alignof(T) <= alignof(std::max_align_t);
+            static constexpr bool poolable = alignof(T) <= ObjectPool::CACHE_LINE;
+
+            // granules of a pool of T only depend on T, the finalizer finds the pool from them
+            static size_t pool_granule_size() noexcept { return ObjectPool::granule_size_for(sizeof(T), alignof(T)); }
+
+            // returns nullptr with a pending JS exception when out of memory
+            template <typename... Args>
+            static T* create(JSContext* ctx, Args&&... args)
+            {
+                if (ObjectPool* pool = object_pool(ctx))
+                {
+                    void* memory = pool->allocate();
+                    if (!memory)
+                    {
+                        JS_ThrowOutOfMemory(ctx);
+                        return nullptr;
+                    }
+                    try
+                    {
+                        return new (memory) T(std::forward<Args>(args)...);
+                    }
+                    catch (...)
+                    {
+                        ObjectPool::release(memory, pool->granule_size());
+                        throw;
+                    }
+                }
+
+                if constexpr (runtime_allocated)
+                {
+                    void* memory = js_malloc(ctx, sizeof(T));
+                    if (!memory)
+                    {
+                        return nullptr;
+                    }
+                    try
+                    {
+                        return new (memory) T(std::forward<Args>(args)...);
+                    }
+                    catch (...)
+                    {
+                        js_free(ctx, memory);
+                        throw;
+                    }
+                }
+                else
+                {
+                    return new T(std::forward<Args>(args)...);
+                }
+            }
+
+            static void destroy(JSRuntime* rt, T* object) noexcept
+            {
+                if constexpr (runtime_allocated)
+                {
+                    object->~T();
+                    js_free_rt(rt, object);
+                }
+                else
+                {
+                    (void)rt;
+                    delete object;
+                }
+            }
+
+            static void destroy_pooled(T* object) noexcept
+            {
+                object->~T();
+                ObjectPool::release(object, pool_granule_size());
+            }
+
+            // pool of T in the runtime of `ctx` if T is pooled there, created on first use.
+            // Slabs are charged to the runtime and returned to it by the time it is freed.
+            static ObjectPool* object_pool(JSContext* ctx)
+            {
+                RuntimeData* data = runtime_data(ctx);
+                ClassEntry* entry = data ? data->classes.find(ClassRegistry::type_index<T>()) : nullptr;
+                if (!entry || !entry->pool_capacity)
+                {
+                    return nullptr;
+                }
+                if (!entry->pool)
+                {
+                    entry->pool = std::make_unique<ObjectPool>(JS_GetRuntime(ctx), sizeof(T), alignof(T), entry->pool_capacity);
+                }
+                return entry->pool.get();
+            }
+        };
+    }
+
+    // member descriptors for ClassTable and ClassBuilder::members, `name` must be a string literal
+    template <auto Member>
+    constexpr detail::MethodDescriptor<Member> method(const char* name) noexcept
+    {
+        return {name};
+    }
+
+    template <auto Member>
+    constexpr detail::FieldDescriptor<Member, true> field(const char* name) noexcept
+    {
+        return {name};
+    }
+
+    template <auto Member>
+    constexpr detail::FieldDescriptor<Member, false> readonly_field(const char* name) noexcept
+    {
+        return {name};
+    }
+
     class Module
     {
     public:
-        Module(const std::string& name, JSContext* ctx);
+        Module(const std::string& name, JSContext* ctx, ModuleLoading loading = ModuleLoading::EAGER);
+
+        // instantiate a shared module definition in `ctx`
+        Module(std::shared_ptr<const ModuleDefinition> definition, JSContext* ctx);
+
         ~Module();
 
         Module(const Module&) = delete;
@@ -44,9 +286,18 @@ namespace js
             using Wrapper = FreeFunctionWrapper<Func>;
             using Traits = detail::FunctionTraits<decltype(Func)>;
 
-            JSValue func = JS_NewCFunction(_ctx, Wrapper::call, name.c_str(), Traits::arity);
             JS_AddModuleExport(_ctx, _mod, name.c_str());
-            _exports.push_back({name, func});
+            if (is_lazy())
+            {
+                detail::ModuleExportEntry entry{name, JS_UNDEFINED};
+                entry.func = Wrapper::call;
+                entry.length = static_cast<int>(Traits::arity);
+                _exports.push_back(std::move(entry));
+            }
+            else
+            {
+                _exports.push_back({name, JS_NewCFunction(_ctx, Wrapper::call, name.c_str(), Traits::arity)});
+            }
 
             return *this;
         }
@@ -61,24 +312,94 @@ namespace js
         const std::string& name() const { return _name; }
         JSContext* context() const { return _ctx; }
         JSModuleDef* module_def() const { return _mod; }
+        bool is_lazy() const noexcept { return _loading == ModuleLoading::LAZY; }
 
+        // export `value`, the module takes ownership of it
         void add_export(const std::string& name, JSValue value);
 
+        // export the value returned by `factory`, called when the module is first imported (right away for eager modules)
+        void add_export(const std::string& name, std::function<JSValue(JSContext*)> factory);
+
     private:
         template <auto Func>
         class FreeFunctionWrapper;
 
         template <typename T>
         friend class ClassBuilder;
+        friend class ModuleDefinition;
 
-        // Static members for module initialization
-        static inline Module* current_module = nullptr;
+        // module initialization, the Module is looked up by its JSModuleDef in the runtime data
         static int module_init_callback(JSContext* ctx, JSModuleDef* m);
 
+        // (un)register this module with the runtime of its context
+        void attach() noexcept;
+        void detach() noexcept;
+
+        // create the value of a lazy export
+        static JSValue instantiate(JSContext* ctx, const detail::ModuleExportEntry& entry);
+
         JSContext* _ctx{nullptr};
         JSModuleDef* _mod{nullptr};
         std::string _name;
+        ModuleLoading _loading{ModuleLoading::EAGER};
         std::vector<detail::ModuleExportEntry> _exports{};
+        std::shared_ptr<const ModuleDefinition> _definition; // set for instantiated definitions, which own the exports
+    };
+
+    // context-independent module description, built once and instantiated into any number of contexts
+    // with Context::add_module(definition). Functions are kept in a JSCFunctionListEntry table that is
+    // handed to quickjs as a whole; class exports are built per context when the module is imported.
+    // A definition must not be modified once it has been instantiated, instantiating is thread-safe.
+    class ModuleDefinition
+    {
+    public:
+        explicit ModuleDefinition(std::string name) : _name(std::move(name)) {}
+
+        ModuleDefinition(const ModuleDefinition&) = delete;
+        ModuleDefinition& operator=(const ModuleDefinition&) = delete;
+
+        // add function to module
+        template <auto Func>
+        ModuleDefinition& function(const std::string& name)
+        {
+            using Wrapper = Module::FreeFunctionWrapper<Func>;
+            using Traits = detail::FunctionTraits<decltype(Func)>;
+
+            JSCFunctionListEntry entry{};
+            entry.name = intern(name);
+            entry.prop_flags = JS_PROP_WRITABLE | JS_PROP_CONFIGURABLE;
+            entry.def_type = JS_DEF_CFUNC;
+            entry.u.func.length = static_cast<uint8_t>(Traits::arity);
+            entry.u.func.cproto = JS_CFUNC_generic;
+            entry.u.func.cfunc.generic = Wrapper::call;
+            _functions.push_back(entry);
+
+            return *this;
+        }
+
+        // add class to module
+        template <typename T>
+        ClassBuilder<T> add_class(const std::string& name)
+        {
+            return ClassBuilder<T>{*this, name};
+        }
+
+        // export the value returned by `factory`, called in every context importing the module
+        ModuleDefinition& add_export(const std::string& name, std::function<JSValue(JSContext*)> factory);
+
+        const std::string& name() const noexcept { return _name; }
+        const std::vector<JSCFunctionListEntry>& functions() const noexcept { return _functions; }
+        const std::vector<detail::ModuleExportEntry>& exports() const noexcept { return _exports; }
+
+    private:
+        // stable copy of `name` for the function table
+        const char* intern(const std::string& name) { return _names.emplace_back(name).c_str(); }
+
+    private:
+        std::string _name;
+        std::deque<std::string> _names;
+        std::vector<JSCFunctionListEntry> _functions;
+        std::vector<detail::ModuleExportEntry> _exports;
     };
 
     // class builder
@@ -87,7 +408,18 @@ namespace js
     {
     public:
         ClassBuilder(Module& module, const std::string& name, JSContext* ctx)
-            : _module(module), _name(name), _context(ctx), _proto(JS_UNDEFINED)
+            : _module(&module), _name(name), _context(ctx), _proto(JS_UNDEFINED)
+        {
+            if (_module->is_lazy())
+            {
+                _members = std::make_shared<std::vector<MemberDefinition>>();
+            }
+        }
+
+        // record the class into a module definition, it is built in each context importing the module
+        ClassBuilder(ModuleDefinition& definition, const std::string& name)
+            : _definition(&definition), _name(name), _context(nullptr), _proto(JS_UNDEFINED),
+              _members(std::make_shared<std::vector<MemberDefinition>>())
         {
         }
 
@@ -95,7 +427,8 @@ namespace js
         ClassBuilder& operator=(const ClassBuilder&) = delete;
 
         ClassBuilder(ClassBuilder&& other) noexcept
-            : _module(other._module), _name(std::move(other._name)), _context(other._context), _proto(other._proto)
+            : _module(other._module), _definition(other._definition), _name(std::move(other._name)), _context(other._context),
+              _proto(other._proto), _members(std::move(other._members)), _pool_capacity(other._pool_capacity)
         {
             other._proto = JS_UNDEFINED;
         }
@@ -108,10 +441,13 @@ namespace js
                 {
                     JS_FreeValue(_context, _proto);
                 }
-                _module = std::move(other._module);
+                _module = other._module;
+                _definition = other._definition;
                 _name = std::move(other._name);
                 _context = other._context;
                 _proto = other._proto;
+                _members = std::move(other._members);
+                _pool_capacity = other._pool_capacity;
                 other._proto = JS_UNDEFINED;
             }
             return *this;
@@ -125,51 +461,161 @@ namespace js
         template <typename... Args>
         ClassBuilder& constructor(const std::string& ctor_name = "");
 
+        // bind a member function, or a data member as a property with native getter/setter
         template <auto Member>
         ClassBuilder& function(const std::string& name);
 
+        // make the class derive from the bound class `Base`: its prototype inherits from the prototype of Base
+        // and methods bound on Base accept objects of this class. Base must be registered in the context first.
+        template <typename Base>
+        ClassBuilder& inherits();
+
+        // allocate the objects of this class from per-runtime slabs of `capacity` objects instead of one heap
+        // block each. Slabs come from the runtime allocator and count toward its memory limit, plus one granule
+        // (at least 4 KiB) of alignment slack each. Must be called before constructor().
+        ClassBuilder& pooled(size_t capacity = 1024)
+        {
+            _pool_capacity = capacity;
+            return *this;
+        }
+
+        // define every member of `table` with a single JS_SetPropertyFunctionList call.
+        // Copies of a table share its entries, which are kept alive by every runtime the table is applied in.
+        ClassBuilder& members(const ClassTable<T>& table);
+
+        // same, building the table from descriptors: members(js::method<&T::f>("f"), js::field<&T::x>("x"))
+        template <typename... Descriptors>
+        ClassBuilder& members(Descriptors... descriptors)
+        {
+            return members(ClassTable<T>(descriptors...));
+        }
+
+        // copy fields into own data properties of every object the constructor creates, instead of exposing them
+        // through accessors: snapshot(js::readonly_field<&T::id>("id"), js::field<&T::score>("score")).
+        // Reads become plain property loads on a shape shared by all objects of the class, but the copies are
+        // taken once: later changes on the C++ side are not seen from JS and JS writes to js::field properties
+        // are not written back (js::readonly_field ones are read-only). Meant for read-mostly records.
+        template <typename... Descriptors>
+        ClassBuilder& snapshot(Descriptors... fields);
+
     private:
+        template <typename>
+        friend class ClassTable;
+
+        // defines one member on the prototype, recorded by lazy modules and definitions until the class is instantiated
+        using MemberDefinition = std::function<void(JSContext*, JSValueConst proto)>;
+
         template <typename ClassType, auto Member>
         struct MemberFunctionWrapper;
 
+        template <auto Member>
+        static void define_member(JSContext* context, JSValueConst proto, const std::string& name);
+
+        template <typename... Args>
+        static JSValue new_constructor(JSContext* context, JSValueConst proto, JSClassID class_id, const std::string& cn);
+
         template <typename ClassType, auto Member>
         struct MemberPropertyWrapper;
 
-        // Get or create class ID for type T
-        JSClassID get_or_create_class_id()
+        template <auto Member, bool Writable>
+        static std::pair<std::string, detail::SnapshotField> snapshot_field(detail::FieldDescriptor<Member, Writable> descriptor)
+        {
+            static_assert(std::is_member_object_pointer_v<decltype(Member)>, "snapshot expects js::field descriptors");
+            detail::SnapshotField field{};
+            field.flags = JS_PROP_ENUMERABLE | (Writable ? JS_PROP_WRITABLE : 0);
+            field.get = [](JSContext* ctx, const void* object) -> JSValue
+            {
+                const auto& value = static_cast<const T*>(object)->*Member;
+                return detail::TypeConverter<detail::remove_cvref_t<decltype(value)>>::to_js(ctx, value);
+            };
+            return {descriptor.name, field};
+        }
+
+        // define the snapshot fields of T on a new object, always in the same order so the objects share one shape
+        static bool snapshot_object(JSContext* ctx, JSValueConst jsobj, const T* object)
+        {
+            detail::RuntimeData* data = detail::runtime_data(ctx);
+            const detail::ClassEntry* entry = data ? data->classes.find(detail::ClassRegistry::type_index<T>()) : nullptr;
+            if (!entry)
+            {
+                return true;
+            }
+
+            for (const detail::SnapshotField& field : entry->snapshot)
+            {
+                JSValue value = field.get(ctx, object);
+                if (JS_IsException(value) || JS_DefinePropertyValue(ctx, jsobj, field.atom, value, field.flags) < 0)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // class id of T in the runtime of `context`, registering the class there on first use.
+        // Whether T is pooled is decided per runtime by its first registration.
+        static JSClassID get_or_create_class_id(JSContext* context, const std::string& class_name, size_t pool_capacity)
         {
-            static JSClassID class_id = 0;
-            if (class_id == 0)
+            detail::RuntimeData* data = detail::runtime_data(context);
+            if (!data)
             {
-                JSRuntime* rt = JS_GetRuntime(_context);
-                JS_NewClassID(rt, &class_id);
+                throw js::Exception("Bound classes require a context created from a js::Runtime");
+            }
 
-                if (!JS_IsRegisteredClass(rt, class_id))
+            detail::ClassEntry& entry = data->classes.get(detail::ClassRegistry::type_index<T>());
+            if (entry.id != JS_INVALID_CLASS_ID)
+            {
+                if ((pool_capacity != 0) != (entry.pool_capacity != 0))
                 {
-                    JSClassDef def = {
-                        _name.c_str(),
-                        // Finalizer
-                        [](JSRuntime* rt, JSValue obj) noexcept
-                        {
-                            void* opaque = JS_GetOpaque(obj, JS_GetClassID(obj));
-                            if (opaque)
-                            {
-                                T** pptr = static_cast<T**>(opaque);
-                                delete *pptr; // delete the object
-                                delete pptr;  // delete the pointer wrapper
-                            }
-                        },
-                        nullptr, nullptr, nullptr};
-                    JS_NewClass(rt, class_id, &def);
+                    console::warn("Class %s is already registered %s, ignoring its pooled() setting", class_name.c_str(),
+                                  entry.pool_capacity ? "as pooled" : "without pooling");
                 }
+                return entry.id;
             }
+
+            bool pooled = pool_capacity != 0 && detail::ObjectStorage<T>::poolable;
+            JSRuntime* rt = JS_GetRuntime(context);
+            JSClassID class_id = JS_INVALID_CLASS_ID;
+            JS_NewClassID(rt, &class_id);
+
+            JSClassDef def = {class_name.c_str(),
+                              pooled ? &finalize_pooled : &finalize,
+                              nullptr, nullptr, nullptr};
+            if (JS_NewClass(rt, class_id, &def) < 0)
+            {
+                throw js::Exception("Failed to register class: " + class_name);
+            }
+
+            entry.id = class_id;
+            entry.pool_capacity = pooled ? pool_capacity : 0;
             return class_id;
         }
 
-        Module& _module;
+        static void finalize(JSRuntime* rt, JSValue obj) noexcept
+        {
+            T* object = static_cast<T*>(JS_GetOpaque(obj, JS_GetClassID(obj)));
+            if (object)
+            {
+                detail::ObjectStorage<T>::destroy(rt, object);
+            }
+        }
+
+        static void finalize_pooled(JSRuntime*, JSValue obj) noexcept
+        {
+            T* object = static_cast<T*>(JS_GetOpaque(obj, JS_GetClassID(obj)));
+            if (object)
+            {
+                detail::ObjectStorage<T>::destroy_pooled(object);
+            }
+        }
+
+        Module* _module{nullptr};
+        ModuleDefinition* _definition{nullptr};
         std::string _name;
         JSContext* _context;
         JSValue _proto;
+        std::shared_ptr<std::vector<MemberDefinition>> _members; // lazy modules and definitions only
+        size_t _pool_capacity{0};
     };
 
     template <auto Func>
@@ -261,7 +707,7 @@ namespace js
             template <size_t... Is>
             static T* create_impl(JSContext* ctx, JSValueConst* argv, std::index_sequence<Is...>)
             {
-                return new T(TypeConverter<remove_cvref_t<Args>>::from_js(ctx, argv[Is])...);
+                return ObjectStorage<T>::create(ctx, TypeConverter<remove_cvref_t<Args>>::from_js(ctx, argv[Is])...);
             }
 
             static T* create(JSContext* ctx, int argc, JSValueConst* argv)
@@ -280,47 +726,70 @@ namespace js
         {
             static T* create(JSContext* ctx, int, JSValueConst*)
             {
-                (void)ctx;
-                return new T();
+                return ObjectStorage<T>::create(ctx);
             }
         };
     }
 
-    // Helper to get class ID for type T at runtime
-    namespace detail
-    {
-        template <typename T>
-        struct ClassIDHolder
-        {
-            static JSClassID class_id;
-        };
-
-        template <typename T>
-        JSClassID ClassIDHolder<T>::class_id = 0;
-    }
-
     template <typename T>
     template <typename... Args>
     ClassBuilder<T>& ClassBuilder<T>::constructor(const std::string& ctor_name)
     {
         std::string cn = ctor_name.empty() ? _name : ctor_name;
 
+        if (_members)
+        {
+            // lazy module or definition: build the prototype and constructor when the module is imported.
+            // Members added after this call are still picked up, they are recorded in the shared list.
+            auto factory = [members = _members, class_name = _name, cn, pool_capacity = _pool_capacity](JSContext* ctx) -> JSValue
+            {
+                JSClassID class_id = get_or_create_class_id(ctx, class_name, pool_capacity);
+
+                JSValue proto = JS_NewObject(ctx);
+                for (const MemberDefinition& define : *members)
+                {
+                    define(ctx, proto);
+                }
+                JSValue ctor = new_constructor<Args...>(ctx, proto, class_id, cn);
+                JS_FreeValue(ctx, proto);
+                return ctor;
+            };
+
+            if (_definition)
+            {
+                _definition->add_export(cn, std::move(factory));
+            }
+            else
+            {
+                _module->add_export(cn, std::move(factory));
+            }
+            return *this;
+        }
+
+        JSClassID class_id = get_or_create_class_id(_context, _name, _pool_capacity);
+
         if (JS_IsUndefined(_proto))
         {
             _proto = JS_NewObject(_context);
         }
 
-        JSClassID class_id = get_or_create_class_id();
-        detail::ClassIDHolder<T>::class_id = class_id;
+        _module->add_export(cn, new_constructor<Args...>(_context, _proto, class_id, cn));
+
+        return *this;
+    }
 
+    template <typename T>
+    template <typename... Args>
+    JSValue ClassBuilder<T>::new_constructor(JSContext* context, JSValueConst proto, JSClassID class_id, const std::string& cn)
+    {
         auto wrapper = [](JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) -> JSValue
         {
             try
             {
                 // Get prototype from constructor
-                JSAtom proto_atom = JS_NewAtom(ctx, "prototype");
-                JSValue proto = JS_GetProperty(ctx, this_val, proto_atom);
-                JS_FreeAtom(ctx, proto_atom);
+                JSAtom proto_atom = QUICKJS_ATOM("prototype").cached(ctx);
+                JSValue proto = proto_atom != JS_ATOM_NULL ? JS_GetProperty(ctx, this_val, proto_atom)
+                                                           : JS_GetPropertyStr(ctx, this_val, "prototype");
 
                 if (JS_IsException(proto))
                 {
@@ -329,7 +798,7 @@ namespace js
                 }
 
                 // Create object with correct class
-                JSClassID cid = detail::ClassIDHolder<T>::class_id;
+                JSClassID cid = detail::class_id_of<T>(ctx);
                 JSValue jsobj = JS_NewObjectProtoClass(ctx, proto, cid);
                 JS_FreeValue(ctx, proto);
 
@@ -345,8 +814,12 @@ namespace js
                     return JS_EXCEPTION;
                 }
 
-                T** pptr = new T*(obj);
-                JS_SetOpaque(jsobj, pptr);
+                JS_SetOpaque(jsobj, obj);
+                if (!snapshot_object(ctx, jsobj, obj))
+                {
+                    JS_FreeValue(ctx, jsobj);
+                    return JS_EXCEPTION;
+                }
                 return jsobj;
             }
             catch (const std::exception& e)
@@ -361,26 +834,43 @@ namespace js
             }
         };
 
-        JSValue ctor = JS_NewCFunction2(_context, wrapper, cn.c_str(), sizeof...(Args), JS_CFUNC_constructor, 0);
+        JSValue ctor = JS_NewCFunction2(context, wrapper, cn.c_str(), sizeof...(Args), JS_CFUNC_constructor, 0);
 
-        JSAtom proto_atom = JS_NewAtom(_context, "prototype");
-        JS_DefinePropertyValue(_context, ctor, proto_atom, JS_DupValue(_context, _proto), JS_PROP_CONFIGURABLE | JS_PROP_WRITABLE);
-        JS_FreeAtom(_context, proto_atom);
+        JSAtom proto_atom = JS_NewAtom(context, "prototype");
+        JS_DefinePropertyValue(context, ctor, proto_atom, JS_DupValue(context, proto), JS_PROP_CONFIGURABLE | JS_PROP_WRITABLE);
+        JS_FreeAtom(context, proto_atom);
 
-        JSAtom ctor_atom = JS_NewAtom(_context, "constructor");
-        JS_DefinePropertyValue(_context, _proto, ctor_atom, JS_DupValue(_context, ctor), JS_PROP_CONFIGURABLE | JS_PROP_WRITABLE);
-        JS_FreeAtom(_context, ctor_atom);
+        JSAtom ctor_atom = JS_NewAtom(context, "constructor");
+        JS_DefinePropertyValue(context, proto, ctor_atom, JS_DupValue(context, ctor), JS_PROP_CONFIGURABLE | JS_PROP_WRITABLE);
+        JS_FreeAtom(context, ctor_atom);
 
-        JS_SetClassProto(_context, class_id, JS_DupValue(_context, _proto));
+        JS_SetClassProto(context, class_id, JS_DupValue(context, proto));
 
-        _module.add_export(cn, ctor);
+        return ctor;
+    }
+
+    template <typename T>
+    template <auto Member>
+    ClassBuilder<T>& ClassBuilder<T>::function(const std::string& name)
+    {
+        if (_members)
+        {
+            _members->push_back([name](JSContext* ctx, JSValueConst proto) { define_member<Member>(ctx, proto, name); });
+            return *this;
+        }
+
+        if (JS_IsUndefined(_proto))
+        {
+            _proto = JS_NewObject(_context);
+        }
+        define_member<Member>(_context, _proto, name);
 
         return *this;
     }
 
     template <typename T>
     template <auto Member>
-    ClassBuilder<T>& ClassBuilder<T>::function(const std::string& name)
+    void ClassBuilder<T>::define_member(JSContext* context, JSValueConst proto, const std::string& name)
     {
         using MemberType = decltype(Member);
 
@@ -389,31 +879,35 @@ namespace js
             using Wrapper = MemberFunctionWrapper<T, Member>;
             using Traits = detail::FunctionTraits<MemberType>;
 
-            JSAtom atom = JS_NewAtom(_context, name.c_str());
-            JSValue func = JS_NewCFunction2(_context, Wrapper::call, name.c_str(), Traits::arity, JS_CFUNC_generic, 0);
+            JSAtom atom = JS_NewAtom(context, name.c_str());
+            JSValue func = JS_NewCFunction2(context, Wrapper::call, name.c_str(), Traits::arity, JS_CFUNC_generic, 0);
 
             if (JS_IsException(func))
             {
-                JS_FreeAtom(_context, atom);
+                JS_FreeAtom(context, atom);
                 throw js::Exception("Failed to create function: " + name);
             }
 
-            JS_DefinePropertyValue(_context, _proto, atom, func, JS_PROP_CONFIGURABLE | JS_PROP_ENUMERABLE | JS_PROP_WRITABLE);
-            JS_FreeAtom(_context, atom);
+            JS_DefinePropertyValue(context, proto, atom, func, JS_PROP_CONFIGURABLE | JS_PROP_ENUMERABLE | JS_PROP_WRITABLE);
+            JS_FreeAtom(context, atom);
         }
         else
         {
             using Wrapper = MemberPropertyWrapper<T, Member>;
 
-            JSAtom atom = JS_NewAtom(_context, name.c_str());
-            JS_DefinePropertyGetSet(_context, _proto, atom,
-                                    JS_NewCFunction2(_context, Wrapper::getter, name.c_str(), 0, JS_CFUNC_generic, 0),
-                                    JS_NewCFunction2(_context, Wrapper::setter, name.c_str(), 1, JS_CFUNC_generic, 0),
+            // getter/setter calling convention, as for JS_DEF_CGETSET: invoked without an argument array
+            JSCFunctionType get{};
+            get.getter = Wrapper::get;
+            JSCFunctionType set{};
+            set.setter = Wrapper::set;
+
+            JSAtom atom = JS_NewAtom(context, name.c_str());
+            JS_DefinePropertyGetSet(context, proto, atom,
+                                    JS_NewCFunction2(context, get.generic, ("get " + name).c_str(), 0, JS_CFUNC_getter, 0),
+                                    JS_NewCFunction2(context, set.generic, ("set " + name).c_str(), 1, JS_CFUNC_setter, 0),
                                     JS_PROP_CONFIGURABLE | JS_PROP_ENUMERABLE);
-            JS_FreeAtom(_context, atom);
+            JS_FreeAtom(context, atom);
         }
-
-        return *this;
     }
 
     template <typename T>
@@ -425,14 +919,12 @@ namespace js
 
         static JSValue call(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) noexcept
         {
-            T** pptr = static_cast<T**>(JS_GetOpaque(this_val, JS_GetClassID(this_val)));
-            if (!pptr || !*pptr)
+            ClassType* obj = detail::unwrap_object<T>(ctx, this_val);
+            if (QUICKJS_UNLIKELY(!obj))
             {
                 return JS_ThrowTypeError(ctx, "Invalid C++ object");
             }
 
-            ClassType* obj = *pptr;
-
             try
             {
                 return invoke(ctx, obj, argc, argv);
@@ -491,34 +983,258 @@ namespace js
     template <typename ClassType, auto Member>
     struct ClassBuilder<T>::MemberPropertyWrapper
     {
-        static T** get_pptr(JSContext* ctx, JSValueConst this_val)
+        // native accessor signatures, used by JS_DEF_CGETSET entries and ClassBuilder::function
+        static JSValue get(JSContext* ctx, JSValueConst this_val) noexcept
         {
-            return static_cast<T**>(JS_GetOpaque(this_val, JS_GetClassID(this_val)));
+            T* obj = detail::unwrap_object<T>(ctx, this_val);
+            if (QUICKJS_UNLIKELY(!obj))
+            {
+                return JS_ThrowTypeError(ctx, "Invalid C++ object");
+            }
+
+            try
+            {
+                auto& val = obj->*Member;
+                return detail::TypeConverter<detail::remove_cvref_t<decltype(val)>>::to_js(ctx, val);
+            }
+            catch (const std::exception& e)
+            {
+                return JS_ThrowInternalError(ctx, "C++ exception: %s", e.what());
+            }
+            catch (...)
+            {
+                return JS_ThrowInternalError(ctx, "Unknown C++ exception");
+            }
         }
 
-        static JSValue getter(JSContext* ctx, JSValueConst this_val, int, JSValueConst*) noexcept
+        static JSValue set(JSContext* ctx, JSValueConst this_val, JSValueConst value) noexcept
         {
-            T** pptr = get_pptr(ctx, this_val);
-            if (!pptr || !*pptr)
+            T* obj = detail::unwrap_object<T>(ctx, this_val);
+            if (QUICKJS_UNLIKELY(!obj))
+            {
+                return JS_ThrowTypeError(ctx, "Invalid C++ object");
+            }
+
+            try
             {
+                auto& member = obj->*Member;
+                member = detail::TypeConverter<detail::remove_cvref_t<decltype(member)>>::from_js(ctx, value);
                 return JS_UNDEFINED;
             }
+            catch (const std::exception& e)
+            {
+                return JS_ThrowInternalError(ctx, "C++ exception: %s", e.what());
+            }
+            catch (...)
+            {
+                return JS_ThrowInternalError(ctx, "Unknown C++ exception");
+            }
+        }
+    };
+
+    // prototype layout of a bound class: a JSCFunctionListEntry table built once from member descriptors
+    // and shared by every context the class is registered in. Fields become native getters/setters
+    // (JS_DEF_CGETSET), which QuickJS calls without building an argument array.
+    //
+    //     static const js::ClassTable<Point> point_members{
+    //         js::method<&Point::length>("length"), js::field<&Point::x>("x"), js::readonly_field<&Point::id>("id")};
+    //     module.add_class<Point>("Point").constructor<double, double>().members(point_members);
+    template <typename T>
+    class ClassTable
+    {
+    public:
+        template <typename... Descriptors>
+        explicit ClassTable(Descriptors... descriptors) : _entries(std::make_shared<std::vector<JSCFunctionListEntry>>())
+        {
+            _entries->reserve(sizeof...(Descriptors));
+            (add(descriptors), ...);
+        }
+
+        const JSCFunctionListEntry* data() const noexcept { return _entries->data(); }
+        int size() const noexcept { return static_cast<int>(_entries->size()); }
+
+        // define all members on `proto`. QuickJS keeps pointers to the entries until a member is first accessed,
+        // so the runtime of `ctx` holds on to them, or to an identical list applied there before.
+        void apply(JSContext* ctx, JSValueConst proto) const
+        {
+            const std::vector<JSCFunctionListEntry>& entries = retain(ctx);
+            if (JS_SetPropertyFunctionList(ctx, proto, entries.data(), static_cast<int>(entries.size())) < 0)
+            {
+                throw js::Exception("Failed to define class members");
+            }
+        }
 
-            auto& val = (*pptr)->*Member;
-            return detail::TypeConverter<detail::remove_cvref_t<decltype(val)>>::to_js(ctx, val);
+    private:
+        template <auto Member>
+        void add(detail::MethodDescriptor<Member> descriptor)
+        {
+            static_assert(std::is_member_function_pointer_v<decltype(Member)>, "js::method expects a member function");
+            using Wrapper = typename ClassBuilder<T>::template MemberFunctionWrapper<T, Member>;
+            using Traits = detail::FunctionTraits<decltype(Member)>;
+
+            JSCFunctionListEntry entry{};
+            entry.name = descriptor.name;
+            entry.prop_flags = JS_PROP_CONFIGURABLE | JS_PROP_ENUMERABLE | JS_PROP_WRITABLE;
+            entry.def_type = JS_DEF_CFUNC;
+            entry.u.func.length = static_cast<uint8_t>(Traits::arity);
+            entry.u.func.cproto = JS_CFUNC_generic;
+            entry.u.func.cfunc.generic = Wrapper::call;
+            _entries->push_back(entry);
         }
 
-        static JSValue setter(JSContext* ctx, JSValueConst this_val, int, JSValueConst* argv) noexcept
+        template <auto Member, bool Writable>
+        void add(detail::FieldDescriptor<Member, Writable> descriptor)
         {
-            T** pptr = get_pptr(ctx, this_val);
-            if (!pptr || !*pptr)
+            static_assert(std::is_member_object_pointer_v<decltype(Member)>, "js::field expects a data member");
+            using Wrapper = typename ClassBuilder<T>::template MemberPropertyWrapper<T, Member>;
+
+            JSCFunctionListEntry entry{};
+            entry.name = descriptor.name;
+            entry.prop_flags = JS_PROP_CONFIGURABLE | JS_PROP_ENUMERABLE;
+            entry.def_type = JS_DEF_CGETSET;
+            entry.u.getset.get.getter = Wrapper::get;
+            entry.u.getset.set.setter = Writable ? Wrapper::set : nullptr;
+            _entries->push_back(entry);
+        }
+
+        const std::vector<JSCFunctionListEntry>& retain(JSContext* ctx) const
+        {
+            detail::RuntimeData* data = detail::runtime_data(ctx);
+            if (!data)
             {
-                return JS_EXCEPTION;
+                throw js::Exception("Bound classes require a context created from a js::Runtime");
             }
 
-            auto& member = (*pptr)->*Member;
-            member = detail::TypeConverter<detail::remove_cvref_t<decltype(member)>>::from_js(ctx, argv[0]);
-            return JS_UNDEFINED;
+            for (const auto& list : data->function_lists)
+            {
+                if (list == _entries || same_entries(*list, *_entries))
+                {
+                    return *list;
+                }
+            }
+            data->function_lists.push_back(_entries);
+            return *_entries;
         }
+
+        static bool same_entries(const std::vector<JSCFunctionListEntry>& a, const std::vector<JSCFunctionListEntry>& b) noexcept
+        {
+            auto same = [](const JSCFunctionListEntry& x, const JSCFunctionListEntry& y)
+            {
+                if (std::strcmp(x.name, y.name) != 0 || x.prop_flags != y.prop_flags || x.def_type != y.def_type)
+                {
+                    return false;
+                }
+                if (x.def_type == JS_DEF_CFUNC)
+                {
+                    return x.u.func.length == y.u.func.length && x.u.func.cproto == y.u.func.cproto &&
+                           x.u.func.cfunc.generic == y.u.func.cfunc.generic;
+                }
+                return x.u.getset.get.generic == y.u.getset.get.generic && x.u.getset.set.generic == y.u.getset.set.generic;
+            };
+            return std::equal(a.begin(), a.end(), b.begin(), b.end(), same);
+        }
+
+    private:
+        // shared by copies of the table and by the runtimes it was applied in
+        std::shared_ptr<std::vector<JSCFunctionListEntry>> _entries;
     };
+
+    template <typename T>
+    template <typename... Descriptors>
+    ClassBuilder<T>& ClassBuilder<T>::snapshot(Descriptors... fields)
+    {
+        std::vector<std::pair<std::string, detail::SnapshotField>> pending{snapshot_field(fields)...};
+        MemberDefinition install = [pending = std::move(pending)](JSContext* ctx, JSValueConst)
+        {
+            detail::RuntimeData* data = detail::runtime_data(ctx);
+            if (!data)
+            {
+                throw js::Exception("Bound classes require a context created from a js::Runtime");
+            }
+
+            std::vector<detail::SnapshotField> snapshot;
+            snapshot.reserve(pending.size());
+            for (const auto& [name, field] : pending)
+            {
+                snapshot.push_back(field);
+                snapshot.back().atom = data->atoms.intern(ctx, name);
+            }
+            data->classes.get(detail::ClassRegistry::type_index<T>()).snapshot = std::move(snapshot);
+        };
+
+        if (_members)
+        {
+            _members->push_back(std::move(install));
+            return *this;
+        }
+        install(_context, JS_UNDEFINED);
+
+        return *this;
+    }
+
+    template <typename T>
+    template <typename Base>
+    ClassBuilder<T>& ClassBuilder<T>::inherits()
+    {
+        static_assert(std::is_base_of_v<Base, T> && !std::is_same_v<Base, T>, "inherits<Base>() expects a base class of T");
+
+        // runs in every runtime the class is built in: records T as a subclass of Base there and chains the prototypes
+        MemberDefinition link = [](JSContext* ctx, JSValueConst proto)
+        {
+            detail::RuntimeData* data = detail::runtime_data(ctx);
+            detail::ClassEntry* base = data ? data->classes.find(detail::ClassRegistry::type_index<Base>()) : nullptr;
+            JSValue base_proto = base && base->id != JS_INVALID_CLASS_ID ? JS_GetClassProto(ctx, base->id) : JS_UNDEFINED;
+            if (!JS_IsObject(base_proto))
+            {
+                JS_FreeValue(ctx, base_proto);
+                throw js::Exception("inherits(): the base class is not registered in this context");
+            }
+
+            size_t index = detail::ClassRegistry::type_index<T>();
+            auto known = [index](const detail::DerivedClass& d) { return d.type_index == index; };
+            if (std::none_of(base->derived.begin(), base->derived.end(), known))
+            {
+                base->derived.push_back({index, [](const detail::ClassRegistry& classes, JSClassID cid, void* opaque) -> void*
+                                         {
+                                             T* object = detail::object_cast<T>(classes, cid, opaque);
+                                             return object ? static_cast<Base*>(object) : nullptr;
+                                         }});
+            }
+
+            JS_SetPrototype(ctx, proto, base_proto);
+            JS_FreeValue(ctx, base_proto);
+        };
+
+        if (_members)
+        {
+            _members->push_back(std::move(link));
+            return *this;
+        }
+
+        if (JS_IsUndefined(_proto))
+        {
+            _proto = JS_NewObject(_context);
+        }
+        link(_context, _proto);
+
+        return *this;
+    }
+
+    template <typename T>
+    ClassBuilder<T>& ClassBuilder<T>::members(const ClassTable<T>& table)
+    {
+        if (_members)
+        {
+            _members->push_back([table](JSContext* ctx, JSValueConst proto) { table.apply(ctx, proto); });
+            return *this;
+        }
+
+        if (JS_IsUndefined(_proto))
+        {
+            _proto = JS_NewObject(_context);
+        }
+        table.apply(_context, _proto);
+
+        return *this;
+    }
 }
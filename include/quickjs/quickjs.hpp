@@ -2,11 +2,22 @@
 
 // QuickJS Wrapper - A modern C++ wrapper for QuickJS
 
-#include "context.hpp"   // IWYU pragma: export
-#include "exception.hpp" // IWYU pragma: export
-#include "macros.hpp"    // IWYU pragma: export
-#include "module.hpp"    // IWYU pragma: export
-#include "rest.hpp"      // IWYU pragma: export
-#include "runtime.hpp"   // IWYU pragma: export
-#include "utils.hpp"     // IWYU pragma: export
-#include "value.hpp"     // IWYU pragma: export
+#include "allocator.hpp"      // IWYU pragma: export
+#include "atom.hpp"           // IWYU pragma: export
+#include "bundle.hpp"         // IWYU pragma: export
+#include "bytecode_cache.hpp" // IWYU pragma: export
+#include "context.hpp"        // IWYU pragma: export
+#include "event_loop.hpp"     // IWYU pragma: export
+#include "exception.hpp"      // IWYU pragma: export
+#include "executor.hpp"       // IWYU pragma: export
+#include "function.hpp"       // IWYU pragma: export
+#include "macros.hpp"         // IWYU pragma: export
+#include "module.hpp"         // IWYU pragma: export
+#include "promise.hpp"        // IWYU pragma: export
+#include "rest.hpp"           // IWYU pragma: export
+#include "runtime.hpp"        // IWYU pragma: export
+#include "runtime_pool.hpp"   // IWYU pragma: export
+#include "span.hpp"           // IWYU pragma: export
+#include "task.hpp"           // IWYU pragma: export
+#include "utils.hpp"          // IWYU pragma: export
+#include "value.hpp"          // IWYU pragma: export
@@ -3,18 +3,223 @@
 #include <quickjs-libc.h>
 #include <quickjs.h>
 
+#include "allocator.hpp"
 #include "macros.hpp"
+#include "atom.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
 namespace js
 {
     class Context;
+    class EventLoop;
+    class Module;
+    class RuntimePool;
+
+    // Limits a single eval or call. QuickJS polls the interrupt handler roughly every 10000
+    // operations; each poll is one tick. The clock is only sampled every few ticks.
+    struct ExecutionBudget
+    {
+        std::chrono::nanoseconds time{0}; // wall-clock limit (0 = none)
+        uint64_t ticks = 0;               // interrupt poll limit (0 = none)
+
+        ExecutionBudget() = default;
+
+        template <typename Rep, typename Period>
+        ExecutionBudget(std::chrono::duration<Rep, Period> duration)
+            : time(std::chrono::duration_cast<std::chrono::nanoseconds>(duration))
+        {
+        }
+
+        // budget expressed in interrupt polls (ticks of roughly 10000 operations) instead of time
+        static ExecutionBudget interrupt_polls(uint64_t ticks) noexcept
+        {
+            ExecutionBudget budget;
+            budget.ticks = ticks;
+            return budget;
+        }
+
+        bool is_unlimited() const noexcept { return time.count() <= 0 && ticks == 0; }
+    };
+
+    namespace detail
+    {
+        struct InterruptState
+        {
+            bool active = false;
+            bool triggered = false;
+            bool has_deadline = false;
+            std::chrono::steady_clock::time_point deadline{};
+            uint64_t tick_limit = 0;
+            uint64_t ticks = 0;
+        };
+
+        class ClassRegistry;
+
+        // bound class deriving from another one: `cast` turns the opaque of an object of class `cid` into a
+        // pointer to the base, nullptr when `cid` is neither the derived class nor one of its own subclasses
+        struct DerivedClass
+        {
+            size_t type_index;
+            void* (*cast)(const ClassRegistry& classes, JSClassID cid, void* opaque);
+        };
+
+        // field of a bound class copied into a data property of each new object, see ClassBuilder::snapshot
+        struct SnapshotField
+        {
+            JSAtom atom; // owned by the runtime's AtomCache
+            int flags;
+            JSValue (*get)(JSContext* ctx, const void* object);
+        };
+
+        // a bound C++ class as registered in one runtime
+        struct ClassEntry
+        {
+            JSClassID id = JS_INVALID_CLASS_ID;
+            size_t pool_capacity = 0;          // objects per slab when the class is pooled
+            std::unique_ptr<ObjectPool> pool;  // created on first construction
+            std::vector<DerivedClass> derived; // bound subclasses, see ClassBuilder::inherits
+            std::vector<SnapshotField> snapshot; // in definition order
+        };
+
+        // per-runtime table of bound classes, indexed by a dense type index that is the same in every runtime.
+        // A class is registered with JS_NewClass the first time a runtime binds it.
+        class ClassRegistry
+        {
+        public:
+            ClassRegistry() noexcept;
+
+            template <typename T>
+            static size_t type_index() noexcept
+            {
+                static const size_t index = next_type_index();
+                return index;
+            }
+
+            const ClassEntry* find(size_t index) const noexcept { return index < _entries.size() ? &_entries[index] : nullptr; }
+            ClassEntry* find(size_t index) noexcept { return index < _entries.size() ? &_entries[index] : nullptr; }
+
+            // entry for `index`, created empty if needed
+            ClassEntry& get(size_t index)
+            {
+                if (index >= _entries.size())
+                {
+                    _entries.resize(index + 1);
+                }
+                return _entries[index];
+            }
+
+            // see ObjectPool::drain, called before the runtime is freed
+            void drain_pools() noexcept
+            {
+                for (ClassEntry& entry : _entries)
+                {
+                    if (entry.pool)
+                    {
+                        entry.pool->drain();
+                    }
+                }
+            }
+
+            // unique among all registries of the process, identifies this one in thread-local lookup caches
+            uint64_t serial() const noexcept { return _serial; }
+
+        private:
+            static size_t next_type_index() noexcept;
+
+        private:
+            std::vector<ClassEntry> _entries;
+            uint64_t _serial;
+        };
+
+        // per-runtime state shared by the wrapper, reachable from any of its contexts
+        // through the context opaque pointer
+        struct RuntimeData
+        {
+            InterruptState interrupt;
+            AtomCache atoms;
+            EventLoop* event_loop = nullptr; // loop driving this runtime, if any
+            std::unordered_map<JSModuleDef*, Module*> modules; // native modules of all contexts, for module_init_callback
+            JSClassID callback_class = JS_INVALID_CLASS_ID; // owner of native promise callbacks, see Promise::on_settled
+            std::vector<std::shared_ptr<std::vector<JSCFunctionListEntry>>> function_lists; // ClassTable entries referenced by prototypes
+            ClassRegistry classes; // bound classes, destroyed (with their object pools) after the runtime is freed
+        };
+
+        inline RuntimeData* runtime_data(JSContext* ctx) noexcept
+        {
+            return ctx ? static_cast<RuntimeData*>(JS_GetContextOpaque(ctx)) : nullptr;
+        }
+
+        // installs a budget on the runtime of `ctx` for the lifetime of the scope
+        class BudgetScope
+        {
+        public:
+            BudgetScope(JSContext* ctx, const ExecutionBudget& budget) noexcept;
+            ~BudgetScope();
+
+            BudgetScope(const BudgetScope&) = delete;
+            BudgetScope& operator=(const BudgetScope&) = delete;
+
+            // true if the budget ran out while the scope was active
+            bool interrupted() const noexcept { return _state && _state->triggered; }
+
+        private:
+            InterruptState* _state{nullptr};
+            InterruptState _saved{};
+        };
+    }
+
+    // snapshot of the heap of a runtime, see Runtime::memory_usage()
+    struct MemoryUsage
+    {
+        // allocator level
+        int64_t heap_size = 0;        // bytes currently allocated
+        int64_t heap_limit = 0;       // memory limit, -1 when unlimited
+        int64_t allocation_count = 0; // live allocations
+        int64_t memory_used_size = 0; // bytes used by the objects below
+        int64_t memory_used_count = 0;
+
+        // object level
+        int64_t atom_count = 0;
+        int64_t atom_size = 0;
+        int64_t string_count = 0;
+        int64_t string_size = 0;
+        int64_t object_count = 0;
+        int64_t object_size = 0;
+        int64_t property_count = 0;
+        int64_t property_size = 0;
+        int64_t shape_count = 0;
+        int64_t shape_size = 0;
+        int64_t js_function_count = 0;
+        int64_t js_function_size = 0;
+        int64_t bytecode_size = 0;
+        int64_t pc2line_count = 0;
+        int64_t pc2line_size = 0;
+        int64_t c_function_count = 0;
+        int64_t array_count = 0;
+        int64_t fast_array_count = 0;
+        int64_t fast_array_elements = 0;
+        int64_t binary_object_count = 0;
+        int64_t binary_object_size = 0;
+    };
 
     class Runtime
     {
         friend class Context;
+        friend class RuntimePool;
 
     public:
         Runtime() QUICKJS_MAYBE_NOEXCEPT;
+
+        // create a runtime whose JS heap is served by `allocator`.
+        // The allocator is owned by the runtime and released after the runtime is freed.
+        explicit Runtime(std::unique_ptr<Allocator> allocator) QUICKJS_MAYBE_NOEXCEPT;
+
         ~Runtime();
 
         Runtime(const Runtime&) = delete;
@@ -26,10 +231,33 @@ namespace js
         // check if the current runtime is valid;
         bool is_valid() const noexcept;
 
+        // limit the JS heap of this runtime, allocations beyond it throw an out-of-memory error (0 = unlimited)
+        void set_memory_limit(size_t limit) noexcept;
+
+        // start a GC cycle whenever the heap grows by this many bytes since the last one
+        void set_gc_threshold(size_t threshold) noexcept;
+        size_t gc_threshold() const noexcept;
+
+        // limit the native stack used by JS code, deeper recursion throws a RangeError (0 = unlimited)
+        void set_max_stack_size(size_t size) noexcept;
+
+        // run a full GC cycle now
+        void run_gc() noexcept;
+
+        // compute heap statistics, note this walks every object of the runtime
+        MemoryUsage memory_usage() const noexcept;
+
     private:
         JSRuntime* get_runtime_handle() const noexcept;
 
+        void init() QUICKJS_MAYBE_NOEXCEPT;
+        void destroy() noexcept;
+
+        static int interrupt_handler(JSRuntime* rt, void* opaque);
+
     private:
         JSRuntime* _runtime;
+        std::unique_ptr<Allocator> _allocator;
+        std::unique_ptr<detail::RuntimeData> _data;
     };
 }
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "macros.hpp"
+#include "context.hpp"
+#include "runtime.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace js
+{
+    struct RuntimePoolOptions
+    {
+        // number of Runtime/Context pairs owned by the pool
+        size_t size = 4;
+
+        // recycle a pair after it has been leased this many times (0 = never)
+        size_t max_uses = 0;
+
+        // recycle a pair when its heap exceeds this many bytes on release (0 = never).
+        // Note: measuring the heap walks every object of the runtime.
+        size_t max_heap_bytes = 0;
+
+        // run a full GC cycle whenever a pair is returned to the pool
+        bool gc_on_release = false;
+
+        // replace every pair with a fresh one when it is returned, so no lease sees the state of another
+        bool recycle_on_release = false;
+
+        // invoked on every pair returned to the pool and not recycled, e.g. to delete the globals a lease
+        // may have added. A pair whose reset throws is recycled instead.
+        std::function<void(Context&)> reset;
+
+        // invoked once for every new pair, e.g. to register modules with Context::add_module
+        std::function<void(Context&)> setup;
+
+        // optional allocator factory, every new runtime gets its own allocator
+        std::function<std::unique_ptr<Allocator>()> allocator;
+    };
+
+    struct RuntimePoolStats
+    {
+        uint64_t leases = 0;
+        uint64_t recycles = 0;
+        uint64_t contended_leases = 0; // leases that had to wait for a free pair
+        std::chrono::nanoseconds total_wait{0};
+        std::chrono::nanoseconds max_wait{0};
+    };
+
+    // A pool of pre-warmed Runtime/Context pairs handed out by RAII leases.
+    // Pairs are reused as they are: globals, prototype changes and pending jobs left by one lease are seen
+    // by the next one unless RuntimePoolOptions::reset clears them or the pair is recycled.
+    // A pair is used by one thread at a time; an idle pair last used by the acquiring
+    // thread is preferred, and a pair moved to another thread gets its stack limit rebased.
+    class RuntimePool
+    {
+        struct Entry;
+
+    public:
+        // exclusive use of one pair, which may still hold the state of earlier leases (see RuntimePoolOptions::reset)
+        class Lease
+        {
+            friend class RuntimePool;
+
+        public:
+            Lease(const Lease&) = delete;
+            Lease& operator=(const Lease&) = delete;
+
+            Lease(Lease&& other) noexcept;
+            Lease& operator=(Lease&& other) noexcept;
+
+            // return the pair to the pool
+            ~Lease();
+
+            Runtime& runtime() const noexcept;
+            Context& context() const noexcept;
+
+            Context* operator->() const noexcept { return &context(); }
+            Context& operator*() const noexcept { return context(); }
+
+        private:
+            Lease(RuntimePool* pool, Entry* entry) noexcept : _pool(pool), _entry(entry) {}
+
+            RuntimePool* _pool;
+            Entry* _entry;
+        };
+
+        explicit RuntimePool(RuntimePoolOptions options = {}) QUICKJS_MAYBE_NOEXCEPT;
+        ~RuntimePool();
+
+        RuntimePool(const RuntimePool&) = delete;
+        RuntimePool& operator=(const RuntimePool&) = delete;
+
+        // lease a pair, blocking until one is free
+        Lease acquire();
+
+        // lease a pair if one is free right now
+        std::optional<Lease> try_acquire();
+
+        RuntimePoolStats stats() const;
+
+        size_t size() const noexcept { return _entries.size(); }
+
+    private:
+        struct Entry
+        {
+            // the context must be destroyed before its runtime
+            std::unique_ptr<Runtime> runtime;
+            std::unique_ptr<Context> context;
+            size_t uses = 0;
+            std::thread::id owner{};
+        };
+
+        void create_pair(Entry& entry) QUICKJS_MAYBE_NOEXCEPT;
+        Entry* take_idle_locked(std::thread::id self);
+        Lease make_lease(Entry* entry, std::thread::id self);
+        void release(Entry* entry) noexcept;
+        bool should_recycle(const Entry& entry) const noexcept;
+
+    private:
+        RuntimePoolOptions _options;
+        std::vector<std::unique_ptr<Entry>> _entries;
+
+        mutable std::mutex _mutex;
+        std::condition_variable _available;
+        std::vector<Entry*> _idle;
+        RuntimePoolStats _stats;
+    };
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace js
+{
+    // non-owning view over contiguous elements (a minimal std::span for C++17).
+    // As a function parameter it views the memory of a JS ArrayBuffer or typed array without copying;
+    // the view is only valid for the duration of the call.
+    template <typename T>
+    class span
+    {
+    public:
+        using element_type = T;
+        using value_type = std::remove_cv_t<T>;
+        using iterator = T*;
+
+        constexpr span() noexcept = default;
+        constexpr span(T* data, size_t size) noexcept : _data(data), _size(size) {}
+
+        template <typename U, typename = std::enable_if_t<std::is_convertible_v<U (*)[], T (*)[]>>>
+        span(std::vector<U>& vec) noexcept : _data(vec.data()), _size(vec.size())
+        {
+        }
+
+        template <typename U, typename = std::enable_if_t<std::is_const_v<T> && std::is_convertible_v<const U (*)[], T (*)[]>>>
+        span(const std::vector<U>& vec) noexcept : _data(vec.data()), _size(vec.size())
+        {
+        }
+
+        constexpr T* data() const noexcept { return _data; }
+        constexpr size_t size() const noexcept { return _size; }
+        constexpr size_t size_bytes() const noexcept { return _size * sizeof(T); }
+        constexpr bool empty() const noexcept { return _size == 0; }
+
+        constexpr T& operator[](size_t index) const noexcept { return _data[index]; }
+
+        constexpr iterator begin() const noexcept { return _data; }
+        constexpr iterator end() const noexcept { return _data + _size; }
+
+    private:
+        T* _data{nullptr};
+        size_t _size{0};
+    };
+
+    // owning numeric buffer exposed to JS as a typed array.
+    // Converting it to JS hands the storage over to the ArrayBuffer without copying.
+    template <typename T>
+    class typed_array
+    {
+    public:
+        using value_type = T;
+
+        typed_array() = default;
+        explicit typed_array(size_t size) : _data(size) {}
+        typed_array(std::vector<T> data) noexcept : _data(std::move(data)) {}
+
+        T* data() noexcept { return _data.data(); }
+        const T* data() const noexcept { return _data.data(); }
+        size_t size() const noexcept { return _data.size(); }
+        bool empty() const noexcept { return _data.empty(); }
+
+        T& operator[](size_t index) { return _data[index]; }
+        const T& operator[](size_t index) const { return _data[index]; }
+
+        typename std::vector<T>::iterator begin() { return _data.begin(); }
+        typename std::vector<T>::iterator end() { return _data.end(); }
+        typename std::vector<T>::const_iterator begin() const { return _data.begin(); }
+        typename std::vector<T>::const_iterator end() const { return _data.end(); }
+
+        std::vector<T>& vector() noexcept { return _data; }
+        const std::vector<T>& vector() const noexcept { return _data; }
+
+        // give up the storage
+        std::vector<T> release() noexcept { return std::move(_data); }
+
+    private:
+        std::vector<T> _data;
+    };
+}
@@ -0,0 +1,391 @@
+#pragma once
+
+// C++20 coroutine bridge, only available when the including translation unit is compiled with coroutine support
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L && __has_include(<coroutine>)
+
+#include "macros.hpp"
+#include "utils.hpp"
+#include "type_converter.hpp"
+#include "exception.hpp"
+#include "promise.hpp"
+#include "value.hpp"
+
+#include <quickjs.h>
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace js
+{
+    template <typename T = void>
+    class Task;
+
+    namespace detail
+    {
+        // settle `resolver` with the outcome of a finished coroutine
+        inline void reject_with(PromiseResolver& resolver, const std::exception_ptr& error)
+        {
+            try
+            {
+                std::rethrow_exception(error);
+            }
+            catch (const std::exception& e)
+            {
+                resolver.reject(std::string(e.what()));
+            }
+            catch (...)
+            {
+                resolver.reject(std::string("Task failed with an unknown exception"));
+            }
+        }
+
+        class TaskPromiseBase
+        {
+        public:
+            // tasks start running right away, up to their first suspension
+            std::suspend_never initial_suspend() noexcept { return {}; }
+
+            void unhandled_exception() noexcept { error = std::current_exception(); }
+
+            std::exception_ptr error;
+            std::coroutine_handle<> continuation;                // coroutine awaiting this task
+            TaskPromiseBase* continuation_promise = nullptr;     // its promise, when it is a task too
+            std::function<void()> on_complete;                   // set when the task is handed off (e.g. to JS)
+            bool detached = false;                               // the frame destroys itself when it finishes
+            bool abandoned = false;                              // can never finish, see abandon_task
+        };
+
+        // the JS promise a suspended task waits on was collected without settling, so the task can never finish.
+        // A detached task is destroyed right away, one still owned by a Task when that Task lets go of it.
+        // The task awaiting it is stuck as well and is abandoned in turn.
+        inline void abandon_task(std::coroutine_handle<> handle, TaskPromiseBase& promise) noexcept
+        {
+            if (promise.detached)
+            {
+                handle.destroy();
+                return;
+            }
+
+            promise.abandoned = true;
+            if (promise.continuation && promise.continuation_promise)
+            {
+                abandon_task(promise.continuation, *promise.continuation_promise);
+            }
+        }
+
+        template <typename PromiseType>
+        struct TaskFinalAwaiter
+        {
+            bool await_ready() const noexcept { return false; }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<PromiseType> handle) noexcept
+            {
+                PromiseType& promise = handle.promise();
+                if (promise.on_complete)
+                {
+                    try
+                    {
+                        promise.on_complete();
+                    }
+                    catch (const std::exception& e)
+                    {
+                        console::error("Failed to settle the promise of a finished task: %s", e.what());
+                    }
+                    catch (...)
+                    {
+                        console::error("Failed to settle the promise of a finished task: unknown C++ exception");
+                    }
+                }
+
+                std::coroutine_handle<> next = promise.continuation ? promise.continuation : std::noop_coroutine();
+                if (promise.detached)
+                {
+                    handle.destroy();
+                }
+                return next;
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        template <typename T>
+        class TaskPromise : public TaskPromiseBase
+        {
+        public:
+            Task<T> get_return_object() noexcept;
+            TaskFinalAwaiter<TaskPromise> final_suspend() noexcept { return {}; }
+
+            template <typename U>
+            void return_value(U&& value)
+            {
+                result.emplace(std::forward<U>(value));
+            }
+
+            T take()
+            {
+                if (error)
+                {
+                    std::rethrow_exception(error);
+                }
+                return std::move(*result);
+            }
+
+            void settle(PromiseResolver& resolver)
+            {
+                if (error)
+                {
+                    reject_with(resolver, error);
+                }
+                else
+                {
+                    resolver.resolve(std::move(*result));
+                }
+            }
+
+            std::optional<T> result;
+        };
+
+        template <>
+        class TaskPromise<void> : public TaskPromiseBase
+        {
+        public:
+            Task<void> get_return_object() noexcept;
+            TaskFinalAwaiter<TaskPromise> final_suspend() noexcept { return {}; }
+
+            void return_void() noexcept {}
+
+            void take()
+            {
+                if (error)
+                {
+                    std::rethrow_exception(error);
+                }
+            }
+
+            void settle(PromiseResolver& resolver)
+            {
+                if (error)
+                {
+                    reject_with(resolver, error);
+                }
+                else
+                {
+                    resolver.resolve(Value());
+                }
+            }
+        };
+
+        // co_await on a Task: the awaiting coroutine is resumed when the task finishes
+        template <typename T>
+        struct TaskAwaiter
+        {
+            std::coroutine_handle<TaskPromise<T>> handle;
+
+            bool await_ready() const noexcept { return !handle || handle.done(); }
+
+            template <typename AwaitingPromise>
+            void await_suspend(std::coroutine_handle<AwaitingPromise> awaiting) noexcept
+            {
+                handle.promise().continuation = awaiting;
+                if constexpr (std::is_base_of_v<TaskPromiseBase, AwaitingPromise>)
+                {
+                    handle.promise().continuation_promise = &awaiting.promise();
+                }
+            }
+
+            T await_resume() { return handle.promise().take(); }
+        };
+    }
+
+    // coroutine result type. A Task runs eagerly until its first suspension and can be co_awaited by
+    // another coroutine, or returned from a function bound with Module::function<&F>, in which case JS
+    // receives a Promise settled with the task's result. Parameters of such coroutines should be taken
+    // by value, references to the converted JS arguments do not outlive the first suspension.
+    // Dropping an unfinished Task lets it run to completion in the background. A task waiting on a JS
+    // promise that is garbage collected without settling is destroyed instead of leaking its frame.
+    template <typename T>
+    class Task
+    {
+    public:
+        using promise_type = detail::TaskPromise<T>;
+        using handle_type = std::coroutine_handle<promise_type>;
+
+        Task() noexcept = default;
+        explicit Task(handle_type handle) noexcept : _handle(handle) {}
+
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        Task(Task&& other) noexcept : _handle(std::exchange(other._handle, nullptr)) {}
+
+        Task& operator=(Task&& other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+                _handle = std::exchange(other._handle, nullptr);
+            }
+            return *this;
+        }
+
+        ~Task() { release(); }
+
+        bool is_valid() const noexcept { return static_cast<bool>(_handle); }
+        bool done() const noexcept { return !_handle || _handle.done(); }
+
+        // result of a finished task, rethrows the exception it finished with
+        T get() { return _handle.promise().take(); }
+
+        // settle `resolver` when the task finishes (right away if it already has), the task lets go of the coroutine
+        void settle_on_completion(std::shared_ptr<PromiseResolver> resolver)
+        {
+            if (!_handle)
+            {
+                return;
+            }
+            if (_handle.done())
+            {
+                _handle.promise().settle(*resolver);
+                return;
+            }
+
+            promise_type& promise = _handle.promise();
+            promise.on_complete = [resolver, &promise] { promise.settle(*resolver); };
+            promise.detached = true;
+            _handle = nullptr;
+        }
+
+        detail::TaskAwaiter<T> operator co_await() && noexcept { return detail::TaskAwaiter<T>{_handle}; }
+
+    private:
+        void release() noexcept
+        {
+            if (!_handle)
+            {
+                return;
+            }
+            if (_handle.done() || _handle.promise().abandoned)
+            {
+                _handle.destroy();
+            }
+            else
+            {
+                _handle.promise().detached = true;
+            }
+            _handle = nullptr;
+        }
+
+    private:
+        handle_type _handle;
+    };
+
+    namespace detail
+    {
+        template <typename T>
+        Task<T> TaskPromise<T>::get_return_object() noexcept
+        {
+            return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+        }
+
+        inline Task<void> TaskPromise<void>::get_return_object() noexcept
+        {
+            return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+        }
+
+        // suspends the awaiting coroutine until a JS promise settles, the coroutine is resumed from a pending job
+        class PromiseAwaiter
+        {
+        public:
+            explicit PromiseAwaiter(Promise promise) : _promise(std::move(promise)) {}
+
+            bool await_ready() const noexcept { return _promise.is_settled(); }
+
+            template <typename AwaitingPromise>
+            void await_suspend(std::coroutine_handle<AwaitingPromise> handle)
+            {
+                auto waiting = std::make_shared<WaitingCoroutine>();
+                waiting->handle = handle;
+                if constexpr (std::is_base_of_v<TaskPromiseBase, AwaitingPromise>)
+                {
+                    waiting->promise = &handle.promise();
+                }
+
+                _promise.on_settled(
+                    [this, waiting](const Value& result, bool rejected)
+                    {
+                        waiting->armed = false;
+                        _result = result;
+                        _rejected = rejected;
+                        _settled = true;
+                        waiting->handle.resume();
+                    });
+                waiting->armed = true;
+            }
+
+            // fulfilled value, a rejection is raised as js::Exception
+            Value await_resume()
+            {
+                if (!_settled)
+                {
+                    _result = _promise.result();
+                    _rejected = _promise.state() == PromiseState::REJECTED;
+                }
+                if (_rejected)
+                {
+                    std::string message = "Promise rejected: " + _result.to_string();
+                    console::error("%s", message.c_str());
+                    QUICKJS_IF_EXCEPTIONS(throw Exception(message));
+                    return Value();
+                }
+                return std::move(_result);
+            }
+
+        private:
+            // held by the settle callback: destroyed without having resumed the coroutine, it abandons a waiting task
+            struct WaitingCoroutine
+            {
+                std::coroutine_handle<> handle;
+                TaskPromiseBase* promise = nullptr;
+                bool armed = false;
+
+                ~WaitingCoroutine()
+                {
+                    if (armed && promise)
+                    {
+                        abandon_task(handle, *promise);
+                    }
+                }
+            };
+
+            Promise _promise;
+            Value _result;
+            bool _rejected{false};
+            bool _settled{false};
+        };
+
+        // Task<T> converter - JS receives a Promise settled with the task's result
+        template <typename T>
+        struct TypeConverter<Task<T>>
+        {
+            static JSValue to_js(JSContext* ctx, Task<T> task)
+            {
+                auto resolver = std::make_shared<PromiseResolver>(ctx);
+                JSValue promise = TypeConverter<Promise>::to_js(ctx, resolver->promise());
+                task.settle_on_completion(std::move(resolver));
+                return promise;
+            }
+        };
+    }
+
+    // co_await a JS promise (or any value, which is returned as is)
+    inline detail::PromiseAwaiter operator co_await(const Promise& promise) { return detail::PromiseAwaiter(promise); }
+    inline detail::PromiseAwaiter operator co_await(const Value& value) { return detail::PromiseAwaiter(Promise(value)); }
+}
+
+#endif
@@ -2,20 +2,88 @@
 
 #include "type_converter.hpp"
 #include "type_traits.hpp"
+#include "atom.hpp"
+#include "runtime.hpp"
+#include "span.hpp"
 
 #include <quickjs.h>
 
+#include <cstddef>
 #include <functional>
+#include <initializer_list>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace js
 {
     class Context;
+    class EventLoop;
+    class Executor;
+    class Promise;
+    class PromiseResolver;
+    class Value;
+
+    template <typename Signature>
+    class Function;
+
+    namespace detail
+    {
+        // argument types that select the non-variadic call overloads
+        template <typename T>
+        inline constexpr bool is_call_arg_list_v =
+            std::is_same_v<T, std::vector<Value>> || std::is_same_v<T, std::initializer_list<Value>> ||
+            std::is_same_v<T, span<const Value>> || std::is_same_v<T, span<Value>> ||
+            std::is_same_v<T, ExecutionBudget>;
+
+        template <typename... Args>
+        inline constexpr bool is_variadic_call_v = sizeof...(Args) > 0 && !(is_call_arg_list_v<std::decay_t<Args>> || ...);
+
+        // arguments of a JS_Call converted one by one, the ones converted so far are freed on scope exit,
+        // also when a later conversion throws
+        template <size_t N>
+        class CallArgs
+        {
+        public:
+            explicit CallArgs(JSContext* ctx) noexcept : _ctx(ctx) {}
+            ~CallArgs()
+            {
+                for (size_t i = 0; i < _count; ++i)
+                {
+                    JS_FreeValue(_ctx, _values[i]);
+                }
+            }
+
+            CallArgs(const CallArgs&) = delete;
+            CallArgs& operator=(const CallArgs&) = delete;
+
+            void push(JSValue value) noexcept { _values[_count++] = value; }
+            JSValue* data() noexcept { return _values; }
+
+        private:
+            JSContext* _ctx;
+            JSValue _values[N > 0 ? N : 1];
+            size_t _count = 0;
+        };
+
+        // take the pending exception of `ctx` and describe it, `what` prefixes the message
+        std::string take_exception_message(JSContext* ctx, const char* what);
+
+        // log the pending exception of a failed call and throw it as js::Exception, `what` prefixes the message
+        void raise_call_exception(JSContext* ctx, const char* what = "JS function threw");
+    }
 
     class Value
     {
         friend class Context;
+        friend class EventLoop;
+        friend class Executor;
+        friend class Promise;
+        friend class PromiseResolver;
+
+        template <typename Signature>
+        friend class Function;
 
     public:
         Value();
@@ -42,6 +110,12 @@ namespace js
         Value operator[](const char* name) const;
         Value operator[](const std::string& name) const;
 
+        // property access by atom, skips hashing the name
+        Value operator[](const Atom& atom) const;
+
+        // property access by static atom, resolved once per runtime, e.g. value[QUICKJS_ATOM("name")]
+        Value operator[](const StaticAtom& atom) const;
+
         // array index access
         Value operator[](uint32_t index) const;
 
@@ -55,11 +129,32 @@ namespace js
         operator int32_t() const;
         operator double() const;
 
-        // function call
+        // function call, arguments are borrowed for the duration of the call
         Value call(const std::vector<Value>& args = {}) const;
+        Value call(std::initializer_list<Value> args) const;
+        Value call(span<const Value> args) const;
         Value call_with_this(Value& this_val, const std::vector<Value>& args = {}) const;
+        Value call_with_this(Value& this_val, std::initializer_list<Value> args) const;
+        Value call_with_this(Value& this_val, span<const Value> args) const;
+
+        // function call with C++ arguments converted through TypeConverter into a stack array
+        template <typename... Args, typename = std::enable_if_t<detail::is_variadic_call_v<Args...>>>
+        Value call(Args&&... args) const
+        {
+            return call_converted(JS_UNDEFINED, std::forward<Args>(args)...);
+        }
+
+        template <typename... Args, typename = std::enable_if_t<detail::is_variadic_call_v<Args...>>>
+        Value call_with_this(Value& this_val, Args&&... args) const
+        {
+            return call_converted(this_val._val, std::forward<Args>(args)...);
+        }
+
+        // function call within an execution budget, throws InterruptedException when it runs out
+        Value call(const std::vector<Value>& args, const ExecutionBudget& budget) const;
+        Value call_with_this(Value& this_val, const std::vector<Value>& args, const ExecutionBudget& budget) const;
 
-        // convert to std::function
+        // convert to std::function (see js::Function for a handle without the std::function overhead)
         template <typename R, typename... Args>
         operator std::function<R(Args...)>() const
         {
@@ -68,30 +163,16 @@ namespace js
                 return nullptr;
             }
 
-            JSContext* ctx = _ctx;
-            JSValue fv = JS_DupValue(_ctx, _val);
-
+            // the captured copy keeps the function alive for as long as the std::function
             return std::function<R(Args...)>(
-                [ctx, fv](Args... args) -> R
+                [fn = *this](Args... args) -> R
                 {
-                    JSValue js_args[] = {detail::TypeConverter<detail::remove_cvref_t<Args>>::to_js(ctx, args)...};
-                    JSValue result = JS_Call(ctx, fv, JS_UNDEFINED, sizeof...(Args), js_args);
-
-                    for (auto& v : js_args)
-                    {
-                        JS_FreeValue(ctx, v);
-                    }
-
-                    if constexpr (std::is_void_v<R>)
-                    {
-                        JS_FreeValue(ctx, result);
-                    }
-                    else
+                    Value result = fn.call_converted(JS_UNDEFINED, args...);
+                    if (JS_IsException(result._val))
                     {
-                        auto res = detail::TypeConverter<R>::from_js(ctx, result);
-                        JS_FreeValue(ctx, result);
-                        return res;
+                        detail::raise_call_exception(fn._ctx);
                     }
+                    return detail::unwrap_free<R>(fn._ctx, result.release());
                 }
                 // clang-format off
             );
@@ -112,6 +193,44 @@ namespace js
         // get context
         JSContext* context() const noexcept;
 
+        // call with borrowed arguments, no dup/free
+        Value invoke(JSValueConst this_val, const Value* args, size_t count) const;
+
+        template <typename T>
+        static JSValue to_call_arg(JSContext* ctx, T&& arg)
+        {
+            if constexpr (std::is_same_v<std::decay_t<T>, Value>)
+                return arg._ctx ? JS_DupValue(ctx, arg._val) : JS_UNDEFINED;
+            else
+                return detail::TypeConverter<std::decay_t<T>>::to_js(ctx, std::forward<T>(arg));
+        }
+
+        template <typename... Args>
+        Value call_converted(JSValueConst this_val, Args&&... args) const
+        {
+            if (!_ctx)
+            {
+                return Value();
+            }
+
+            if constexpr (sizeof...(Args) == 0)
+            {
+                return Value(_ctx, JS_Call(_ctx, _val, this_val, 0, nullptr));
+            }
+            else
+            {
+                detail::CallArgs<sizeof...(Args)> js_args(_ctx);
+                (js_args.push(to_call_arg(_ctx, std::forward<Args>(args))), ...);
+                return Value(_ctx, JS_Call(_ctx, _val, this_val, static_cast<int>(sizeof...(Args)), js_args.data()));
+            }
+        }
+
+        // get a property by atom, `name` is only used for diagnostics
+        Value get_property(JSAtom atom, const char* name) const;
+
+        // turn an exception raised by an exhausted budget into InterruptedException
+        Value check_interrupted(Value result, const detail::BudgetScope& scope) const;
+
     private:
         JSContext* _ctx;
         JSValue _val;
@@ -0,0 +1,410 @@
+#include "allocator.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace js
+{
+    namespace
+    {
+        constexpr size_t ALIGNMENT = alignof(std::max_align_t);
+
+        constexpr size_t align_up(size_t size) noexcept { return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1); }
+
+        // QuickJS asks for the usable size without passing the opaque pointer,
+        // so every block handed to QuickJS is prefixed with its requested size.
+        struct alignas(ALIGNMENT) BlockHeader
+        {
+            size_t size;
+        };
+
+        constexpr size_t HEADER_SIZE = sizeof(BlockHeader);
+
+        BlockHeader* header_of(const void* ptr) noexcept
+        {
+            return reinterpret_cast<BlockHeader*>(static_cast<uint8_t*>(const_cast<void*>(ptr)) - HEADER_SIZE);
+        }
+
+        void* js_malloc_hook(void* opaque, size_t size)
+        {
+            auto* header = static_cast<BlockHeader*>(static_cast<Allocator*>(opaque)->allocate(HEADER_SIZE + size));
+            if (!header) return nullptr;
+            header->size = size;
+            return header + 1;
+        }
+
+        void* js_calloc_hook(void* opaque, size_t count, size_t size)
+        {
+            if (size != 0 && count > (SIZE_MAX - HEADER_SIZE) / size) return nullptr;
+            void* ptr = js_malloc_hook(opaque, count * size);
+            if (ptr) std::memset(ptr, 0, count * size);
+            return ptr;
+        }
+
+        void js_free_hook(void* opaque, void* ptr)
+        {
+            if (!ptr) return;
+            BlockHeader* header = header_of(ptr);
+            static_cast<Allocator*>(opaque)->deallocate(header, HEADER_SIZE + header->size);
+        }
+
+        void* js_realloc_hook(void* opaque, void* ptr, size_t size)
+        {
+            if (!ptr) return size ? js_malloc_hook(opaque, size) : nullptr;
+            if (size == 0)
+            {
+                js_free_hook(opaque, ptr);
+                return nullptr;
+            }
+
+            BlockHeader* header = header_of(ptr);
+            auto* moved = static_cast<BlockHeader*>(static_cast<Allocator*>(opaque)->reallocate(header, HEADER_SIZE + header->size, HEADER_SIZE + size));
+            if (!moved) return nullptr;
+            moved->size = size;
+            return moved + 1;
+        }
+
+        size_t js_usable_size_hook(const void* ptr)
+        {
+            return ptr ? header_of(ptr)->size : 0;
+        }
+    }
+
+    void* Allocator::reallocate(void* ptr, size_t old_size, size_t new_size) noexcept
+    {
+        void* block = allocate(new_size);
+        if (!block) return nullptr;
+        std::memcpy(block, ptr, std::min(old_size, new_size));
+        deallocate(ptr, old_size);
+        return block;
+    }
+
+    const JSMallocFunctions& Allocator::malloc_functions() noexcept
+    {
+        static const JSMallocFunctions functions = {
+            js_calloc_hook,
+            js_malloc_hook,
+            js_free_hook,
+            js_realloc_hook,
+            js_usable_size_hook,
+        };
+        return functions;
+    }
+
+    // PoolAllocator
+
+    PoolAllocator::~PoolAllocator()
+    {
+        for (void* chunk : _chunks)
+        {
+            std::free(chunk);
+        }
+    }
+
+    void* PoolAllocator::refill(size_t index) noexcept
+    {
+        size_t block_size = class_size(index);
+        if (static_cast<size_t>(_limit - _cursor) < block_size)
+        {
+            void* chunk = std::malloc(CHUNK_SIZE);
+            if (!chunk) return nullptr;
+            _chunks.push_back(chunk);
+            _cursor = static_cast<uint8_t*>(chunk);
+            _limit = _cursor + CHUNK_SIZE;
+        }
+
+        void* block = _cursor;
+        _cursor += block_size;
+        return block;
+    }
+
+    void* PoolAllocator::allocate(size_t size) noexcept
+    {
+        if (size == 0 || size > MAX_POOLED_SIZE)
+        {
+            return std::malloc(size ? size : 1);
+        }
+
+        size_t index = class_index(size);
+        if (FreeBlock* block = _free[index])
+        {
+            _free[index] = block->next;
+            return block;
+        }
+        return refill(index);
+    }
+
+    void PoolAllocator::deallocate(void* ptr, size_t size) noexcept
+    {
+        if (!ptr) return;
+        if (size == 0 || size > MAX_POOLED_SIZE)
+        {
+            std::free(ptr);
+            return;
+        }
+
+        size_t index = class_index(size);
+        auto* block = static_cast<FreeBlock*>(ptr);
+        block->next = _free[index];
+        _free[index] = block;
+    }
+
+    void* PoolAllocator::reallocate(void* ptr, size_t old_size, size_t new_size) noexcept
+    {
+        bool old_pooled = old_size != 0 && old_size <= MAX_POOLED_SIZE;
+        bool new_pooled = new_size != 0 && new_size <= MAX_POOLED_SIZE;
+
+        if (old_pooled && new_pooled && class_index(old_size) == class_index(new_size))
+        {
+            return ptr;
+        }
+        if (!old_pooled && !new_pooled)
+        {
+            return std::realloc(ptr, new_size);
+        }
+        return Allocator::reallocate(ptr, old_size, new_size);
+    }
+
+    // ArenaAllocator
+
+    ArenaAllocator::ArenaAllocator(size_t chunk_size) noexcept : _chunk_size(align_up(std::max<size_t>(chunk_size, 4096))) {}
+
+    ArenaAllocator::~ArenaAllocator()
+    {
+        for (void* chunk : _chunks)
+        {
+            std::free(chunk);
+        }
+    }
+
+    void* ArenaAllocator::allocate(size_t size) noexcept
+    {
+        size_t needed = align_up(size ? size : 1);
+
+        if (static_cast<size_t>(_limit - _cursor) < needed)
+        {
+            // oversized blocks get a dedicated chunk and leave the current one in place
+            if (needed > _chunk_size / 4)
+            {
+                void* block = std::malloc(needed);
+                if (!block) return nullptr;
+                _chunks.push_back(block);
+                _reserved += needed;
+                return block;
+            }
+
+            void* chunk = std::malloc(_chunk_size);
+            if (!chunk) return nullptr;
+            _chunks.push_back(chunk);
+            _reserved += _chunk_size;
+            _cursor = static_cast<uint8_t*>(chunk);
+            _limit = _cursor + _chunk_size;
+        }
+
+        _last = _cursor;
+        _cursor += needed;
+        return _last;
+    }
+
+    void ArenaAllocator::deallocate(void* ptr, size_t) noexcept
+    {
+        // only the most recent block can be handed back, everything else goes with the arena
+        if (ptr && ptr == _last)
+        {
+            _cursor = _last;
+            _last = nullptr;
+        }
+    }
+
+    void* ArenaAllocator::reallocate(void* ptr, size_t old_size, size_t new_size) noexcept
+    {
+        if (ptr == _last)
+        {
+            // resize the most recent block in place when the chunk has room
+            if (static_cast<size_t>(_limit - _last) >= align_up(new_size))
+            {
+                _cursor = _last + align_up(new_size);
+                return ptr;
+            }
+        }
+        else if (align_up(new_size) <= align_up(old_size))
+        {
+            return ptr;
+        }
+
+        return Allocator::reallocate(ptr, old_size, new_size);
+    }
+
+    // ObjectPool
+
+    namespace
+    {
+        size_t next_power_of_two(size_t value) noexcept
+        {
+            size_t result = 1;
+            while (result < value)
+            {
+                result <<= 1;
+            }
+            return result;
+        }
+    }
+
+    size_t ObjectPool::block_size_for(size_t object_size, size_t object_alignment) noexcept
+    {
+        // small blocks are rounded to a power of two so they pack evenly into cache lines,
+        // larger ones to whole cache lines
+        size_t size = std::max({object_size, object_alignment, sizeof(FreeBlock)});
+        return size <= CACHE_LINE ? next_power_of_two(size) : (size + CACHE_LINE - 1) & ~(CACHE_LINE - 1);
+    }
+
+    size_t ObjectPool::granule_size_for(size_t object_size, size_t object_alignment) noexcept
+    {
+        return std::max(MIN_GRANULE, next_power_of_two(sizeof(SlabHeader) + block_size_for(object_size, object_alignment)));
+    }
+
+    ObjectPool::ObjectPool(JSRuntime* rt, size_t object_size, size_t object_alignment, size_t blocks_per_slab)
+        : _runtime(rt),
+          _block_size(block_size_for(object_size, object_alignment)),
+          _granule_size(granule_size_for(object_size, object_alignment))
+    {
+        size_t blocks_per_granule = (_granule_size - sizeof(SlabHeader)) / _block_size;
+        _granules_per_slab = (std::max<size_t>(blocks_per_slab, 1) + blocks_per_granule - 1) / blocks_per_granule;
+    }
+
+    ObjectPool::~ObjectPool()
+    {
+        // once draining, the runtime is gone and any slab left holds blocks that were never released
+        if (!_draining)
+        {
+            for (SlabHeader* slab : _slabs)
+            {
+                js_free_rt(_runtime, slab->memory);
+            }
+        }
+    }
+
+    bool ObjectPool::grow() noexcept
+    {
+        // over-allocate by one granule and align by hand
+        size_t size = _granules_per_slab * _granule_size;
+        void* memory = js_malloc_rt(_runtime, size + _granule_size);
+        if (!memory)
+        {
+            return false;
+        }
+        auto* begin = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(memory) + _granule_size - 1) & ~(uintptr_t(_granule_size) - 1));
+        auto* slab = new (begin) SlabHeader{this, nullptr, memory, 0};
+        slab->slab = slab;
+        try
+        {
+            _slabs.push_back(slab);
+        }
+        catch (...)
+        {
+            js_free_rt(_runtime, memory);
+            return false;
+        }
+
+        for (size_t i = 1; i < _granules_per_slab; ++i)
+        {
+            new (begin + i * _granule_size) SlabHeader{this, slab, nullptr, 0};
+        }
+        _cursor = begin + sizeof(SlabHeader);
+        _limit = begin + _granule_size;
+        _slab_end = begin + size;
+        return true;
+    }
+
+    void ObjectPool::free_slab(SlabHeader* slab) noexcept
+    {
+        _slabs.erase(std::find(_slabs.begin(), _slabs.end(), slab));
+        js_free_rt(_runtime, slab->memory);
+    }
+
+    void* ObjectPool::allocate() noexcept
+    {
+        if (_draining)
+        {
+            return nullptr;
+        }
+
+        void* block = nullptr;
+        if (_free)
+        {
+            block = _free;
+            _free = _free->next;
+        }
+        else
+        {
+            if (static_cast<size_t>(_limit - _cursor) < _block_size)
+            {
+                if (_limit != _slab_end)
+                {
+                    // next granule of the current slab, past its header
+                    _cursor = _limit + sizeof(SlabHeader);
+                    _limit += _granule_size;
+                }
+                else if (!grow())
+                {
+                    return nullptr;
+                }
+            }
+            block = _cursor;
+            _cursor += _block_size;
+        }
+        ++header_of(block, _granule_size)->slab->live;
+        ++_live;
+        return block;
+    }
+
+    void ObjectPool::release(void* block, size_t granule_size) noexcept
+    {
+        if (!block)
+        {
+            return;
+        }
+
+        SlabHeader* header = header_of(block, granule_size);
+        ObjectPool* pool = header->pool;
+        SlabHeader* slab = header->slab;
+        --slab->live;
+        --pool->_live;
+
+        if (pool->_draining)
+        {
+            if (slab->live == 0)
+            {
+                pool->free_slab(slab);
+            }
+            return;
+        }
+
+        auto* free_block = static_cast<FreeBlock*>(block);
+        free_block->next = pool->_free;
+        pool->_free = free_block;
+    }
+
+    void ObjectPool::drain() noexcept
+    {
+        _draining = true;
+        _free = nullptr;
+        _cursor = _limit = _slab_end = nullptr;
+
+        size_t kept = 0;
+        for (SlabHeader* slab : _slabs)
+        {
+            if (slab->live == 0)
+            {
+                js_free_rt(_runtime, slab->memory);
+            }
+            else
+            {
+                _slabs[kept++] = slab;
+            }
+        }
+        _slabs.resize(kept);
+    }
+}
@@ -11,10 +11,11 @@ namespace js
     {
     public:
         JSString(JSContext* ctx, JSValueConst value)
-            : ctx(ctx), str(JS_ToCString(ctx, value)), len(0)
+            : ctx(ctx), str(nullptr), len(0)
         {
-            if (str)
-                len = strlen(str);
+            str = JS_ToCStringLen(ctx, &len, value);
+            if (!str)
+                len = 0;
         }
 
         ~JSString()
@@ -3,10 +3,12 @@
 #include "../core/macros.hpp"
 #include "../core/utils.hpp"
 #include "../js_types/rest.hpp"
+#include "../js_types/span.hpp"
 #include "js_string.hpp"
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <quickjs.h>
 
 #include <optional>
@@ -49,6 +51,83 @@ namespace js
             }
         }
 
+        // typed array kind matching the element type T, or -1 when T has no typed array counterpart
+        template <typename T>
+        constexpr int typed_array_type() noexcept
+        {
+            if constexpr (std::is_same_v<T, int8_t>)
+                return JS_TYPED_ARRAY_INT8;
+            else if constexpr (std::is_same_v<T, uint8_t>)
+                return JS_TYPED_ARRAY_UINT8;
+            else if constexpr (std::is_same_v<T, int16_t>)
+                return JS_TYPED_ARRAY_INT16;
+            else if constexpr (std::is_same_v<T, uint16_t>)
+                return JS_TYPED_ARRAY_UINT16;
+            else if constexpr (std::is_same_v<T, int32_t>)
+                return JS_TYPED_ARRAY_INT32;
+            else if constexpr (std::is_same_v<T, uint32_t>)
+                return JS_TYPED_ARRAY_UINT32;
+            else if constexpr (std::is_same_v<T, int64_t>)
+                return JS_TYPED_ARRAY_BIG_INT64;
+            else if constexpr (std::is_same_v<T, uint64_t>)
+                return JS_TYPED_ARRAY_BIG_UINT64;
+            else if constexpr (std::is_same_v<T, float>)
+                return JS_TYPED_ARRAY_FLOAT32;
+            else if constexpr (std::is_same_v<T, double>)
+                return JS_TYPED_ARRAY_FLOAT64;
+            else
+                return -1;
+        }
+
+        template <typename T>
+        inline constexpr bool is_typed_array_element_v = typed_array_type<T>() >= 0;
+
+        // locate the backing memory of an ArrayBuffer, or of a typed array whose kind matches `type`.
+        // Returns false when the value is neither (or the kinds differ); throws when the buffer is unusable.
+        inline bool buffer_view(JSContext* ctx, JSValueConst value, int type, uint8_t** data, size_t* bytes)
+        {
+            size_t size = 0;
+            int kind = JS_GetTypedArrayType(value);
+            if (kind >= 0)
+            {
+                if (kind != type && !(type == JS_TYPED_ARRAY_UINT8 && kind == JS_TYPED_ARRAY_UINT8C))
+                    return false;
+
+                size_t offset = 0, length = 0, element_size = 0;
+                JSValue buffer = JS_GetTypedArrayBuffer(ctx, value, &offset, &length, &element_size);
+                if (JS_IsException(buffer))
+                    throw std::runtime_error("Failed to get typed array buffer");
+                uint8_t* base = JS_GetArrayBuffer(ctx, &size, buffer);
+                // the typed array keeps its buffer alive
+                JS_FreeValue(ctx, buffer);
+                if (!base && length != 0)
+                    throw std::runtime_error("Typed array buffer is detached");
+                *data = base ? base + offset : nullptr;
+                *bytes = length;
+                return true;
+            }
+            if (JS_IsArrayBuffer(value))
+            {
+                uint8_t* base = JS_GetArrayBuffer(ctx, &size, value);
+                if (!base && size != 0)
+                    throw std::runtime_error("ArrayBuffer is detached");
+                *data = base;
+                *bytes = size;
+                return true;
+            }
+            return false;
+        }
+
+        // wrap `buffer` (consumed) in a typed array of the given kind
+        inline JSValue new_typed_array(JSContext* ctx, JSValue buffer, int type)
+        {
+            if (JS_IsException(buffer))
+                return buffer;
+            JSValue result = JS_NewTypedArray(ctx, 1, &buffer, static_cast<JSTypedArrayEnum>(type));
+            JS_FreeValue(ctx, buffer);
+            return result;
+        }
+
         template <>
         struct TypeConverter<int32_t>
         {
@@ -207,12 +286,58 @@ namespace js
             }
         };
 
+        // element conversion that reads numbers straight from the value tag before falling back to TypeConverter
+        template <typename T>
+        T element_from_js(JSContext* ctx, JSValueConst value)
+        {
+            const int tag = JS_VALUE_GET_NORM_TAG(value);
+            if constexpr (std::is_same_v<T, int32_t> || std::is_same_v<T, int64_t>)
+            {
+                if (tag == JS_TAG_INT)
+                    return JS_VALUE_GET_INT(value);
+            }
+            else if constexpr (std::is_same_v<T, double>)
+            {
+                if (tag == JS_TAG_FLOAT64)
+                    return JS_VALUE_GET_FLOAT64(value);
+                if (tag == JS_TAG_INT)
+                    return JS_VALUE_GET_INT(value);
+            }
+            else if constexpr (std::is_same_v<T, bool>)
+            {
+                if (tag == JS_TAG_BOOL)
+                    return JS_VALUE_GET_BOOL(value) != 0;
+            }
+            return TypeConverter<T>::from_js(ctx, value);
+        }
+
         // std::vector<T> converter - generic version
         template <typename T>
         struct TypeConverter<std::vector<T>>
         {
             static JSValue to_js(JSContext* ctx, const std::vector<T>& value)
             {
+#if QJS_VERSION_MAJOR > 0 || QJS_VERSION_MINOR >= 10
+                // build the elements first and hand them over in one step, the array gets its final length up front
+                if (value.size() <= static_cast<size_t>(INT32_MAX))
+                {
+                    std::vector<JSValue> values;
+                    values.reserve(value.size());
+                    try
+                    {
+                        for (const auto& item : value)
+                            values.push_back(TypeConverter<T>::to_js(ctx, item));
+                    }
+                    catch (...)
+                    {
+                        for (JSValue& item : values)
+                            JS_FreeValue(ctx, item);
+                        throw;
+                    }
+                    // takes ownership of the elements, also on failure
+                    return JS_NewArrayFrom(ctx, static_cast<int>(values.size()), values.data());
+                }
+#endif
                 JSValue arr = JS_NewArray(ctx);
                 for (size_t i = 0; i < value.size(); ++i)
                 {
@@ -225,6 +350,22 @@ namespace js
             static std::vector<T> from_js(JSContext* ctx, JSValueConst value)
             {
                 std::vector<T> result;
+                if constexpr (is_typed_array_element_v<T>)
+                {
+                    // typed arrays and ArrayBuffers of matching element type are copied in one go
+                    uint8_t* data = nullptr;
+                    size_t bytes = 0;
+                    if (buffer_view(ctx, value, typed_array_type<T>(), &data, &bytes))
+                    {
+                        if (bytes % sizeof(T) != 0)
+                            throw std::runtime_error("ArrayBuffer size is not a multiple of the element size");
+                        result.resize(bytes / sizeof(T));
+                        if (!result.empty())
+                            std::memcpy(result.data(), data, result.size() * sizeof(T));
+                        return result;
+                    }
+                }
+
                 int64_t len = 0;
                 if (JS_GetLength(ctx, value, &len) == 0 && len > 0)
                 {
@@ -232,7 +373,15 @@ namespace js
                     for (int64_t i = 0; i < len; ++i)
                     {
                         JSValue elem = JS_GetPropertyUint32(ctx, value, static_cast<uint32_t>(i));
-                        result.push_back(TypeConverter<T>::from_js(ctx, elem));
+                        try
+                        {
+                            result.push_back(element_from_js<T>(ctx, elem));
+                        }
+                        catch (...)
+                        {
+                            JS_FreeValue(ctx, elem);
+                            throw;
+                        }
                         JS_FreeValue(ctx, elem);
                     }
                 }
@@ -240,6 +389,66 @@ namespace js
             }
         };
 
+        // span<T> converter - from_js views the JS buffer in place, to_js copies into a new typed array
+        template <typename T>
+        struct TypeConverter<span<T>>
+        {
+            using element_type = std::remove_const_t<T>;
+            static_assert(is_typed_array_element_v<element_type>, "span<T> requires a typed array element type");
+
+            static JSValue to_js(JSContext* ctx, span<T> value)
+            {
+                JSValue buffer = JS_NewArrayBufferCopy(ctx, reinterpret_cast<const uint8_t*>(value.data()),
+                                                       value.size_bytes());
+                return new_typed_array(ctx, buffer, typed_array_type<element_type>());
+            }
+
+            static span<T> from_js(JSContext* ctx, JSValueConst value)
+            {
+                uint8_t* data = nullptr;
+                size_t bytes = 0;
+                if (!buffer_view(ctx, value, typed_array_type<element_type>(), &data, &bytes))
+                    throw std::runtime_error("Expected an ArrayBuffer or a matching typed array");
+                if (bytes % sizeof(T) != 0)
+                    throw std::runtime_error("ArrayBuffer size is not a multiple of the element size");
+                return span<T>(reinterpret_cast<T*>(data), bytes / sizeof(T));
+            }
+        };
+
+        // typed_array<T> converter - to_js hands the vector storage to the ArrayBuffer without copying
+        template <typename T>
+        struct TypeConverter<typed_array<T>>
+        {
+            static_assert(is_typed_array_element_v<T>, "typed_array<T> requires a typed array element type");
+
+            static JSValue to_js(JSContext* ctx, typed_array<T> value)
+            {
+                if (value.empty())
+                    return new_typed_array(ctx, JS_NewArrayBufferCopy(ctx, nullptr, 0), typed_array_type<T>());
+
+                auto* storage = new std::vector<T>(value.release());
+                JSValue buffer = JS_NewArrayBuffer(ctx, reinterpret_cast<uint8_t*>(storage->data()),
+                                                   storage->size() * sizeof(T), &free_storage, storage, false);
+                if (JS_IsException(buffer))
+                {
+                    delete storage;
+                    return buffer;
+                }
+                return new_typed_array(ctx, buffer, typed_array_type<T>());
+            }
+
+            static typed_array<T> from_js(JSContext* ctx, JSValueConst value)
+            {
+                return typed_array<T>(TypeConverter<std::vector<T>>::from_js(ctx, value));
+            }
+
+        private:
+            static void free_storage(JSRuntime*, void* opaque, void*)
+            {
+                delete static_cast<std::vector<T>*>(opaque);
+            }
+        };
+
         // std::optional<T> converter
         template <typename T>
         struct TypeConverter<std::optional<T>>
@@ -0,0 +1,142 @@
+#include "atom.hpp"
+
+#include "runtime.hpp"
+
+#include <atomic>
+
+namespace js
+{
+    namespace
+    {
+        std::atomic<size_t> next_static_atom_index{0};
+    }
+
+    Atom::Atom(JSContext* ctx, const char* name) : _ctx(ctx), _atom(ctx ? JS_NewAtom(ctx, name) : JS_ATOM_NULL) {}
+
+    Atom::Atom(JSContext* ctx, const std::string& name)
+        : _ctx(ctx), _atom(ctx ? JS_NewAtomLen(ctx, name.data(), name.size()) : JS_ATOM_NULL)
+    {
+    }
+
+    Atom Atom::adopt(JSContext* ctx, JSAtom atom) noexcept
+    {
+        Atom result;
+        result._ctx = ctx;
+        result._atom = atom;
+        return result;
+    }
+
+    Atom::Atom(const Atom& other) : _ctx(other._ctx), _atom(other._ctx ? JS_DupAtom(other._ctx, other._atom) : JS_ATOM_NULL) {}
+
+    Atom& Atom::operator=(const Atom& other)
+    {
+        if (this != &other)
+        {
+            if (_ctx)
+            {
+                JS_FreeAtom(_ctx, _atom);
+            }
+            _ctx = other._ctx;
+            _atom = _ctx ? JS_DupAtom(_ctx, other._atom) : JS_ATOM_NULL;
+        }
+        return *this;
+    }
+
+    Atom::Atom(Atom&& other) noexcept : _ctx(other._ctx), _atom(other._atom)
+    {
+        other._ctx = nullptr;
+        other._atom = JS_ATOM_NULL;
+    }
+
+    Atom& Atom::operator=(Atom&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (_ctx)
+            {
+                JS_FreeAtom(_ctx, _atom);
+            }
+            _ctx = other._ctx;
+            _atom = other._atom;
+            other._ctx = nullptr;
+            other._atom = JS_ATOM_NULL;
+        }
+        return *this;
+    }
+
+    Atom::~Atom()
+    {
+        if (_ctx)
+        {
+            JS_FreeAtom(_ctx, _atom);
+        }
+    }
+
+    StaticAtom::StaticAtom(const char* name) noexcept
+        : _name(name), _index(next_static_atom_index.fetch_add(1, std::memory_order_relaxed))
+    {
+    }
+
+    JSAtom StaticAtom::cached(JSContext* ctx) const
+    {
+        detail::RuntimeData* data = detail::runtime_data(ctx);
+        return data ? data->atoms.get(ctx, *this, _index) : JS_ATOM_NULL;
+    }
+
+    Atom StaticAtom::atom(JSContext* ctx) const
+    {
+        JSAtom atom = cached(ctx);
+        return atom != JS_ATOM_NULL ? Atom::adopt(ctx, JS_DupAtom(ctx, atom)) : Atom(ctx, _name);
+    }
+
+    namespace detail
+    {
+        JSAtom AtomCache::get(JSContext* ctx, const StaticAtom& atom, size_t index)
+        {
+            if (index < _static.size() && _static[index] != JS_ATOM_NULL)
+            {
+                return _static[index];
+            }
+
+            if (index >= _static.size())
+            {
+                _static.resize(index + 1, JS_ATOM_NULL);
+            }
+            _static[index] = JS_NewAtom(ctx, atom.name());
+            return _static[index];
+        }
+
+        JSAtom AtomCache::intern(JSContext* ctx, const std::string& name)
+        {
+            auto it = _interned.find(name);
+            if (it != _interned.end())
+            {
+                return it->second;
+            }
+
+            JSAtom atom = JS_NewAtomLen(ctx, name.data(), name.size());
+            if (atom != JS_ATOM_NULL)
+            {
+                _interned.emplace(name, atom);
+            }
+            return atom;
+        }
+
+        void AtomCache::clear(JSRuntime* rt) noexcept
+        {
+            for (JSAtom atom : _static)
+            {
+                if (atom != JS_ATOM_NULL)
+                {
+                    JS_FreeAtomRT(rt, atom);
+                }
+            }
+            for (auto& entry : _interned)
+            {
+                JS_FreeAtomRT(rt, entry.second);
+            }
+            _static.clear();
+            _interned.clear();
+        }
+    }
+}
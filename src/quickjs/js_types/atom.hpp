@@ -0,0 +1,97 @@
+#pragma once
+
+#include <quickjs.h>
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace js
+{
+    // RAII wrapper for a JSAtom
+    class Atom
+    {
+    public:
+        Atom() noexcept : _ctx(nullptr), _atom(JS_ATOM_NULL) {}
+        Atom(JSContext* ctx, const char* name);
+        Atom(JSContext* ctx, const std::string& name);
+
+        // take ownership of an existing atom reference
+        static Atom adopt(JSContext* ctx, JSAtom atom) noexcept;
+
+        Atom(const Atom& other);
+        Atom& operator=(const Atom& other);
+
+        Atom(Atom&& other) noexcept;
+        Atom& operator=(Atom&& other) noexcept;
+
+        ~Atom();
+
+        bool is_valid() const noexcept { return _ctx && _atom != JS_ATOM_NULL; }
+        JSAtom get() const noexcept { return _atom; }
+        JSContext* context() const noexcept { return _ctx; }
+
+    private:
+        JSContext* _ctx;
+        JSAtom _atom;
+    };
+
+    // An atom for a string with static storage duration, resolved once per runtime and then
+    // looked up by index without hashing. Use QUICKJS_ATOM("name") to create one in place.
+    class StaticAtom
+    {
+    public:
+        explicit StaticAtom(const char* name) noexcept;
+
+        StaticAtom(const StaticAtom&) = delete;
+        StaticAtom& operator=(const StaticAtom&) = delete;
+
+        const char* name() const noexcept { return _name; }
+
+        // the atom cached in the runtime of `ctx`, still owned by the cache.
+        // Returns JS_ATOM_NULL if the context was not created from a js::Runtime.
+        JSAtom cached(JSContext* ctx) const;
+
+        // a new reference to the atom (falls back to JS_NewAtom without a cache)
+        Atom atom(JSContext* ctx) const;
+
+    private:
+        const char* _name;
+        size_t _index;
+    };
+
+    namespace detail
+    {
+        // per-runtime atom cache, see RuntimeData
+        class AtomCache
+        {
+        public:
+            AtomCache() = default;
+
+            AtomCache(const AtomCache&) = delete;
+            AtomCache& operator=(const AtomCache&) = delete;
+
+            JSAtom get(JSContext* ctx, const StaticAtom& atom, size_t index);
+
+            // atom for a name fixed by the program, such as a snapshot field; it stays pinned until the
+            // runtime is freed, so never pass names that come from scripts or other input
+            JSAtom intern(JSContext* ctx, const std::string& name);
+
+            // release every cached atom, must run before the runtime is freed
+            void clear(JSRuntime* rt) noexcept;
+
+        private:
+            std::vector<JSAtom> _static;
+            std::unordered_map<std::string, JSAtom> _interned;
+        };
+    }
+}
+
+// static atom for a string literal, e.g. value[QUICKJS_ATOM("length")]
+#define QUICKJS_ATOM(name)                                  \
+    ([]() -> const ::js::StaticAtom&                        \
+     {                                                      \
+         static const ::js::StaticAtom quickjs_atom_{name}; \
+         return quickjs_atom_;                              \
+     }())
@@ -0,0 +1,184 @@
+#include "bundle.hpp"
+
+#include "../core/utils.hpp"
+#include "../exception/exception.hpp"
+
+#include <cstring>
+#include <fstream>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace js
+{
+    namespace detail
+    {
+#if defined(_WIN32)
+        MappedFile::MappedFile(const std::string& path) noexcept
+        {
+            HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE) return;
+            _file = file;
+
+            LARGE_INTEGER size{};
+            if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) return;
+
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!mapping) return;
+            _mapping = mapping;
+
+            void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (!view) return;
+
+            _data = static_cast<const uint8_t*>(view);
+            _size = static_cast<size_t>(size.QuadPart);
+        }
+
+        MappedFile::~MappedFile()
+        {
+            if (_data) UnmapViewOfFile(_data);
+            if (_mapping) CloseHandle(static_cast<HANDLE>(_mapping));
+            if (_file) CloseHandle(static_cast<HANDLE>(_file));
+        }
+#else
+        MappedFile::MappedFile(const std::string& path) noexcept
+        {
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) return;
+
+            struct stat st{};
+            if (fstat(fd, &st) == 0 && st.st_size > 0)
+            {
+                void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+                if (addr != MAP_FAILED)
+                {
+                    _data = static_cast<const uint8_t*>(addr);
+                    _size = static_cast<size_t>(st.st_size);
+                }
+            }
+
+            // the mapping stays valid after the descriptor is closed
+            close(fd);
+        }
+
+        MappedFile::~MappedFile()
+        {
+            if (_data)
+            {
+                munmap(const_cast<uint8_t*>(_data), _size);
+            }
+        }
+#endif
+    }
+
+    BundleWriter::BundleWriter(Context& context) : _context(context) {}
+
+    bool BundleWriter::add_script(const std::string& name, const std::string& code, JSEvalOptions flags) QUICKJS_MAYBE_NOEXCEPT
+    {
+        int32_t eval_flags = static_cast<int32_t>(flags) & ~JS_EVAL_TYPE_MASK;
+        return add_entry(name, code, eval_flags | JS_EVAL_TYPE_GLOBAL, detail::BundleEntryKind::SCRIPT);
+    }
+
+    bool BundleWriter::add_module(const std::string& name, const std::string& code) QUICKJS_MAYBE_NOEXCEPT
+    {
+        return add_entry(name, code, JS_EVAL_TYPE_MODULE, detail::BundleEntryKind::MODULE);
+    }
+
+    bool BundleWriter::add_entry(const std::string& name, const std::string& code, int32_t flags, detail::BundleEntryKind kind) QUICKJS_MAYBE_NOEXCEPT
+    {
+        JSContext* ctx = _context.get_context_handle();
+
+        JSValue func = JS_Eval(ctx, code.c_str(), code.size(), name.c_str(), flags | JS_EVAL_FLAG_COMPILE_ONLY);
+        if (JS_IsException(func))
+        {
+            _context.make_eval_result(func, name);
+            return false;
+        }
+
+        size_t size = 0;
+        uint8_t* buf = JS_WriteObject(ctx, &size, func, JS_WRITE_OBJ_BYTECODE);
+        JS_FreeValue(ctx, func);
+
+        if (!buf)
+        {
+            JS_FreeValue(ctx, JS_GetException(ctx));
+            console::error("Failed to serialize bytecode (name: \"%s\")", name.c_str());
+            QUICKJS_IF_EXCEPTIONS(throw Exception("Failed to serialize bytecode (name: \"" + name + "\")", ctx));
+            return false;
+        }
+
+        _entries.push_back({name, kind, Bytecode(buf, buf + size)});
+        js_free(ctx, buf);
+        return true;
+    }
+
+    bool BundleWriter::write(const std::string& path) const
+    {
+        constexpr uint64_t alignment = 8;
+        auto align_up = [](uint64_t offset) { return (offset + alignment - 1) & ~(alignment - 1); };
+
+        std::vector<detail::BundleIndexEntry> index(_entries.size());
+
+        uint64_t offset = sizeof(detail::BundleHeader) + sizeof(detail::BundleIndexEntry) * _entries.size();
+        for (size_t i = 0; i < _entries.size(); ++i)
+        {
+            index[i].name_offset = offset;
+            index[i].name_size = static_cast<uint32_t>(_entries[i].name.size());
+            index[i].kind = _entries[i].kind;
+            offset += _entries[i].name.size();
+        }
+        for (size_t i = 0; i < _entries.size(); ++i)
+        {
+            offset = align_up(offset);
+            index[i].data_offset = offset;
+            index[i].data_size = _entries[i].bytecode.size();
+            offset += _entries[i].bytecode.size();
+        }
+
+        detail::BundleHeader header{};
+        std::memcpy(header.magic, detail::BUNDLE_MAGIC, sizeof(header.magic));
+        header.version = detail::BUNDLE_VERSION;
+        header.entry_count = static_cast<uint32_t>(_entries.size());
+        header.index_offset = sizeof(detail::BundleHeader);
+        header.file_size = offset;
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            console::error("Failed to open bundle for writing: %s", path.c_str());
+            return false;
+        }
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(sizeof(detail::BundleIndexEntry) * index.size()));
+        for (const auto& entry : _entries)
+        {
+            out.write(entry.name.data(), static_cast<std::streamsize>(entry.name.size()));
+        }
+
+        static const char padding[alignment] = {};
+        uint64_t written = index.empty() ? header.file_size : index.back().name_offset + index.back().name_size;
+        for (size_t i = 0; i < _entries.size(); ++i)
+        {
+            out.write(padding, static_cast<std::streamsize>(index[i].data_offset - written));
+            out.write(reinterpret_cast<const char*>(_entries[i].bytecode.data()), static_cast<std::streamsize>(_entries[i].bytecode.size()));
+            written = index[i].data_offset + index[i].data_size;
+        }
+
+        if (!out)
+        {
+            console::error("Failed to write bundle: %s", path.c_str());
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "../core/macros.hpp"
+#include "bytecode_cache.hpp"
+#include "context.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <vector>
+
+namespace js
+{
+    namespace detail
+    {
+        // On-disk bundle layout (native byte order, all offsets are absolute):
+        //   BundleHeader | BundleIndexEntry[entry_count] | entry names | bytecode blobs (8-byte aligned)
+        // The blobs are JS_WriteObject output and are only valid for the QuickJS version that produced them.
+        inline constexpr char BUNDLE_MAGIC[4] = {'Q', 'J', 'S', 'B'};
+        inline constexpr uint32_t BUNDLE_VERSION = 1;
+
+        enum class BundleEntryKind : uint32_t
+        {
+            SCRIPT = 0,
+            MODULE = 1
+        };
+
+        struct BundleHeader
+        {
+            char magic[4];
+            uint32_t version;
+            uint32_t entry_count;
+            uint32_t reserved;
+            uint64_t index_offset;
+            uint64_t file_size;
+        };
+
+        struct BundleIndexEntry
+        {
+            uint64_t name_offset;
+            uint64_t data_offset;
+            uint64_t data_size;
+            uint32_t name_size;
+            BundleEntryKind kind;
+        };
+
+        static_assert(sizeof(BundleHeader) == 32, "unexpected bundle header layout");
+        static_assert(sizeof(BundleIndexEntry) == 32, "unexpected bundle index layout");
+
+        // RAII read-only memory mapping of a whole file
+        class MappedFile
+        {
+        public:
+            explicit MappedFile(const std::string& path) noexcept;
+            ~MappedFile();
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            bool is_valid() const noexcept { return _data != nullptr; }
+            const uint8_t* data() const noexcept { return _data; }
+            size_t size() const noexcept { return _size; }
+
+        private:
+            const uint8_t* _data{nullptr};
+            size_t _size{0};
+#if defined(_WIN32)
+            void* _file{nullptr};
+            void* _mapping{nullptr};
+#endif
+        };
+    }
+
+    // Ahead-of-time compiler for bytecode bundles loaded by Context::load_bundle.
+    // Entries are instantiated in insertion order, so add imported modules before their importers.
+    class BundleWriter
+    {
+    public:
+        // sources are compiled in `context`, which is otherwise left untouched
+        explicit BundleWriter(Context& context);
+
+        // compile a global script, returns false (after reporting the error) when it fails to compile
+        bool add_script(const std::string& name, const std::string& code, JSEvalOptions flags = JSEvalOptions::TYPE_GLOBAL | JSEvalOptions::FLAG_STRICT) QUICKJS_MAYBE_NOEXCEPT;
+
+        // compile an ES module, `name` is the specifier other modules import it by. returns false on failure
+        bool add_module(const std::string& name, const std::string& code) QUICKJS_MAYBE_NOEXCEPT;
+
+        // write the bundle file, returns false on I/O failure
+        bool write(const std::string& path) const;
+
+        size_t size() const noexcept { return _entries.size(); }
+
+    private:
+        struct Entry
+        {
+            std::string name;
+            detail::BundleEntryKind kind;
+            Bytecode bytecode;
+        };
+
+        bool add_entry(const std::string& name, const std::string& code, int32_t flags, detail::BundleEntryKind kind) QUICKJS_MAYBE_NOEXCEPT;
+
+    private:
+        Context& _context;
+        std::vector<Entry> _entries;
+    };
+}
@@ -0,0 +1,75 @@
+#include "bytecode_cache.hpp"
+
+#include <functional>
+#include <string_view>
+
+namespace js
+{
+    BytecodeCache::BytecodeCache(size_t capacity) : _capacity(capacity == 0 ? 1 : capacity) {}
+
+    size_t BytecodeCache::KeyHash::operator()(const Key& key) const noexcept
+    {
+        size_t h = key.source_hash;
+        h ^= std::hash<std::string>{}(key.filename) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+        h ^= std::hash<int32_t>{}(key.flags) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+        return h;
+    }
+
+    BytecodeCache::Key BytecodeCache::make_key(const std::string& source, const std::string& filename, int32_t flags)
+    {
+        return Key{std::hash<std::string_view>{}(source), flags, filename};
+    }
+
+    std::shared_ptr<const Bytecode> BytecodeCache::find(const std::string& source, const std::string& filename, int32_t flags)
+    {
+        Key key = make_key(source, filename, flags);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _entries.find(key);
+        if (it == _entries.end() || it->second.source != source)
+        {
+            return nullptr;
+        }
+
+        _lru.splice(_lru.begin(), _lru, it->second.lru_pos);
+        return it->second.bytecode;
+    }
+
+    void BytecodeCache::insert(const std::string& source, const std::string& filename, int32_t flags, std::shared_ptr<const Bytecode> bytecode)
+    {
+        Key key = make_key(source, filename, flags);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _entries.find(key);
+        if (it != _entries.end())
+        {
+            // same key: either a concurrent compile of the same script or a hash collision, keep the newest
+            it->second.source = source;
+            it->second.bytecode = std::move(bytecode);
+            _lru.splice(_lru.begin(), _lru, it->second.lru_pos);
+            return;
+        }
+
+        if (_entries.size() >= _capacity)
+        {
+            _entries.erase(_lru.back());
+            _lru.pop_back();
+        }
+
+        _lru.push_front(key);
+        _entries.emplace(std::move(key), Entry{source, std::move(bytecode), _lru.begin()});
+    }
+
+    void BytecodeCache::clear()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _entries.clear();
+        _lru.clear();
+    }
+
+    size_t BytecodeCache::size() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _entries.size();
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace js
+{
+    // serialized bytecode of a compiled script
+    using Bytecode = std::vector<uint8_t>;
+
+    // A cache of compiled scripts, keyed by source hash + filename + eval flags.
+    // The cached bytes are produced by JS_WriteObject and are not bound to any runtime,
+    // so one cache can be shared between several contexts (access is guarded by a mutex).
+    class BytecodeCache
+    {
+    public:
+        explicit BytecodeCache(size_t capacity = 1024);
+
+        BytecodeCache(const BytecodeCache&) = delete;
+        BytecodeCache& operator=(const BytecodeCache&) = delete;
+
+        // look up the bytecode compiled from `source`, returns nullptr on miss
+        std::shared_ptr<const Bytecode> find(const std::string& source, const std::string& filename, int32_t flags);
+
+        // store the bytecode compiled from `source`, evicting the least recently used entry when full
+        void insert(const std::string& source, const std::string& filename, int32_t flags, std::shared_ptr<const Bytecode> bytecode);
+
+        // drop all cached entries
+        void clear();
+
+        size_t size() const;
+        size_t capacity() const noexcept { return _capacity; }
+
+    private:
+        struct Key
+        {
+            size_t source_hash;
+            int32_t flags;
+            std::string filename;
+
+            bool operator==(const Key& other) const noexcept
+            {
+                return source_hash == other.source_hash && flags == other.flags && filename == other.filename;
+            }
+        };
+
+        struct KeyHash
+        {
+            size_t operator()(const Key& key) const noexcept;
+        };
+
+        struct Entry
+        {
+            // the full source is kept to rule out hash collisions
+            std::string source;
+            std::shared_ptr<const Bytecode> bytecode;
+            std::list<Key>::iterator lru_pos;
+        };
+
+        static Key make_key(const std::string& source, const std::string& filename, int32_t flags);
+
+    private:
+        mutable std::mutex _mutex;
+        size_t _capacity;
+        std::list<Key> _lru;
+        std::unordered_map<Key, Entry, KeyHash> _entries;
+    };
+}
@@ -1,11 +1,13 @@
 #include "context.hpp"
 #include "../exception/exception.hpp"
+#include "bundle.hpp"
 #include "module.hpp"
 
 #include "../core/macros.hpp"
 #include "../core/utils.hpp"
 
 #include <cstdint>
+#include <cstring>
 #include <string>
 
 namespace js
@@ -29,7 +31,9 @@ namespace js
         {
             console::error("Failed to create JS context.");
             QUICKJS_IF_EXCEPTIONS(throw Exception("Failed to create JS context."));
+            return;
         }
+        JS_SetContextOpaque(_context, runtime._data.get());
     }
 
     void Context::import_os_module() const noexcept
@@ -92,7 +96,12 @@ namespace js
     }
 
     Context::Context(Context&& other) noexcept
-        : _context(other._context), _modules(std::move(other._modules))
+        : _context(other._context),
+          _modules(std::move(other._modules)),
+          _on_exception(std::move(other._on_exception)),
+          _bytecode_cache(std::move(other._bytecode_cache)),
+          _bytecode_cache_hits(other._bytecode_cache_hits),
+          _bytecode_cache_misses(other._bytecode_cache_misses)
     {
         other._context = nullptr;
     }
@@ -108,6 +117,10 @@ namespace js
             }
             _context = other._context;
             _modules = std::move(other._modules);
+            _on_exception = std::move(other._on_exception);
+            _bytecode_cache = std::move(other._bytecode_cache);
+            _bytecode_cache_hits = other._bytecode_cache_hits;
+            _bytecode_cache_misses = other._bytecode_cache_misses;
             other._context = nullptr;
         }
         return *this;
@@ -117,8 +130,110 @@ namespace js
 
     Value Context::eval(const std::string& code, const std::string& filename, JSEvalOptions flags) QUICKJS_MAYBE_NOEXCEPT
     {
-        JSValue result = JS_Eval(_context, code.c_str(), code.size(), filename.c_str(), static_cast<int32_t>(flags));
+        return make_eval_result(eval_raw(code, filename, static_cast<int32_t>(flags)), filename);
+    }
+
+    Value Context::eval(const std::string& code, const std::string& filename, JSEvalOptions flags, const ExecutionBudget& budget) QUICKJS_MAYBE_NOEXCEPT
+    {
+        detail::BudgetScope scope(_context, budget);
+        JSValue result = eval_raw(code, filename, static_cast<int32_t>(flags));
+
+        if (JS_IsException(result) && scope.interrupted())
+        {
+            // the interrupt error is uncatchable, drop it instead of reporting it as a script error
+            JS_FreeValue(_context, JS_GetException(_context));
+            console::warn("JS code interrupted, execution budget exhausted (filename: \"%s\")", filename.c_str());
+            QUICKJS_IF_EXCEPTIONS(throw InterruptedException(std::string("Execution budget exhausted (filename: \"") + filename + "\")", _context));
+            return Value(_context, JS_UNDEFINED);
+        }
+
+        return make_eval_result(result, filename);
+    }
+
+    Promise Context::eval_async(const std::string& code, const std::string& filename, JSEvalOptions flags) QUICKJS_MAYBE_NOEXCEPT
+    {
+        int32_t raw_flags = static_cast<int32_t>(flags);
+        bool global = (raw_flags & JS_EVAL_TYPE_MASK) == JS_EVAL_TYPE_GLOBAL;
+        if (global)
+        {
+            raw_flags |= JS_EVAL_FLAG_ASYNC;
+        }
+
+        // async global scripts fulfill with a { value } record
+        return Promise(make_eval_result(eval_raw(code, filename, raw_flags), filename), global);
+    }
+
+    size_t Context::run_pending_jobs(size_t max_jobs) QUICKJS_MAYBE_NOEXCEPT
+    {
+        return _context ? detail::run_pending_jobs(JS_GetRuntime(_context), max_jobs) : 0;
+    }
+
+    bool Context::has_pending_jobs() const noexcept
+    {
+        return _context && JS_IsJobPending(JS_GetRuntime(_context));
+    }
+
+    PromiseResolver Context::new_promise()
+    {
+        return PromiseResolver(_context);
+    }
+
+    JSValue Context::eval_raw(const std::string& code, const std::string& filename, int32_t flags)
+    {
+        // only global scripts are replayed from the cache, modules are registered by name when evaluated
+        bool cacheable = _bytecode_cache &&
+                         (flags & JS_EVAL_TYPE_MASK) == JS_EVAL_TYPE_GLOBAL &&
+                         !(flags & JS_EVAL_FLAG_COMPILE_ONLY);
+
+        return cacheable ? eval_cached(code, filename, flags)
+                         : JS_Eval(_context, code.c_str(), code.size(), filename.c_str(), flags);
+    }
+
+    JSValue Context::eval_cached(const std::string& code, const std::string& filename, int32_t flags)
+    {
+        std::shared_ptr<const Bytecode> bytecode = _bytecode_cache->find(code, filename, flags);
+
+        JSValue func;
+        if (bytecode)
+        {
+            ++_bytecode_cache_hits;
+            func = JS_ReadObject(_context, bytecode->data(), bytecode->size(), JS_READ_OBJ_BYTECODE);
+        }
+        else
+        {
+            ++_bytecode_cache_misses;
+            func = JS_Eval(_context, code.c_str(), code.size(), filename.c_str(), flags | JS_EVAL_FLAG_COMPILE_ONLY);
+            if (JS_IsException(func))
+            {
+                return func;
+            }
 
+            size_t size = 0;
+            uint8_t* buf = JS_WriteObject(_context, &size, func, JS_WRITE_OBJ_BYTECODE);
+            if (buf)
+            {
+                _bytecode_cache->insert(code, filename, flags, std::make_shared<const Bytecode>(buf, buf + size));
+                js_free(_context, buf);
+            }
+            else
+            {
+                // not fatal, the compiled function is still valid
+                JS_FreeValue(_context, JS_GetException(_context));
+                console::warn("Failed to serialize bytecode (filename: \"%s\")", filename.c_str());
+            }
+        }
+
+        if (JS_IsException(func))
+        {
+            return func;
+        }
+
+        // JS_EvalFunction takes ownership of func
+        return JS_EvalFunction(_context, func);
+    }
+
+    Value Context::make_eval_result(JSValue result, const std::string& filename) QUICKJS_MAYBE_NOEXCEPT
+    {
         if (JS_IsException(result))
         {
             if (_on_exception)
@@ -134,6 +249,115 @@ namespace js
         return Value(_context, result);
     }
 
+    size_t Context::load_bundle(const std::string& path) QUICKJS_MAYBE_NOEXCEPT
+    {
+        auto fail = [&](const char* reason) -> size_t
+        {
+            console::error("Failed to load bundle \"%s\": %s", path.c_str(), reason);
+            QUICKJS_IF_EXCEPTIONS(throw Exception("Failed to load bundle \"" + path + "\": " + reason, _context));
+            return 0;
+        };
+
+        detail::MappedFile file(path);
+        if (!file.is_valid())
+        {
+            return fail("cannot map file");
+        }
+
+        const uint8_t* base = file.data();
+        const size_t size = file.size();
+
+        detail::BundleHeader header;
+        if (size < sizeof(header))
+        {
+            return fail("file too small");
+        }
+        std::memcpy(&header, base, sizeof(header));
+
+        if (std::memcmp(header.magic, detail::BUNDLE_MAGIC, sizeof(header.magic)) != 0)
+        {
+            return fail("bad magic");
+        }
+        if (header.version != detail::BUNDLE_VERSION)
+        {
+            return fail("unsupported bundle version");
+        }
+        if (header.file_size != size || header.index_offset > size ||
+            header.entry_count > (size - header.index_offset) / sizeof(detail::BundleIndexEntry))
+        {
+            return fail("truncated or corrupted file");
+        }
+
+        auto index_entry = [&](uint32_t i)
+        {
+            detail::BundleIndexEntry entry;
+            std::memcpy(&entry, base + header.index_offset + i * sizeof(entry), sizeof(entry));
+            return entry;
+        };
+
+        // validate the whole index before evaluating anything
+        for (uint32_t i = 0; i < header.entry_count; ++i)
+        {
+            detail::BundleIndexEntry entry = index_entry(i);
+            if (entry.name_offset > size || entry.name_size > size - entry.name_offset ||
+                entry.data_offset > size || entry.data_size > size - entry.data_offset)
+            {
+                return fail("index entry out of bounds");
+            }
+            if (entry.kind != detail::BundleEntryKind::SCRIPT && entry.kind != detail::BundleEntryKind::MODULE)
+            {
+                return fail("unknown entry kind");
+            }
+        }
+
+        size_t loaded = 0;
+        for (uint32_t i = 0; i < header.entry_count; ++i)
+        {
+            detail::BundleIndexEntry entry = index_entry(i);
+            std::string name(reinterpret_cast<const char*>(base + entry.name_offset), entry.name_size);
+            bool is_module = entry.kind == detail::BundleEntryKind::MODULE;
+
+            // the bytecode is read straight from the mapped pages
+            JSValue obj = JS_ReadObject(_context, base + entry.data_offset, entry.data_size, JS_READ_OBJ_BYTECODE);
+            if (!JS_IsException(obj) && is_module && JS_ResolveModule(_context, obj) < 0)
+            {
+                JS_FreeValue(_context, obj);
+                obj = JS_EXCEPTION;
+            }
+
+            JSValue result = JS_IsException(obj) ? obj : JS_EvalFunction(_context, obj);
+
+            // a module evaluates to a promise, which is already rejected when its top-level code threw
+            if (is_module && JS_IsPromise(result) && JS_PromiseState(_context, result) == JS_PROMISE_REJECTED)
+            {
+                JS_Throw(_context, JS_PromiseResult(_context, result));
+                JS_FreeValue(_context, result);
+                result = JS_EXCEPTION;
+            }
+
+            if (JS_IsException(result))
+            {
+                make_eval_result(result, name);
+                return loaded;
+            }
+
+            JS_FreeValue(_context, result);
+            ++loaded;
+        }
+
+        return loaded;
+    }
+
+    void Context::enable_bytecode_cache(std::shared_ptr<BytecodeCache> cache)
+    {
+        _bytecode_cache = std::move(cache);
+    }
+
+    void Context::disable_bytecode_cache() noexcept
+    {
+        _bytecode_cache.reset();
+    }
+
     Value Context::get_global() const
     {
         return Value(_context, JS_GetGlobalObject(_context));
@@ -144,9 +368,25 @@ namespace js
         return Value(_context, JS_GetException(_context));
     }
 
+    Atom Context::atom(const std::string& name) const
+    {
+        return Atom(_context, name);
+    }
+
     Module& Context::add_module(const std::string& name)
     {
-        _modules.emplace_back(name, _context);
+        return add_module(name, ModuleLoading::EAGER);
+    }
+
+    Module& Context::add_module(const std::string& name, ModuleLoading loading)
+    {
+        _modules.emplace_back(name, _context, loading);
+        return _modules.back();
+    }
+
+    Module& Context::add_module(std::shared_ptr<const ModuleDefinition> definition)
+    {
+        _modules.emplace_back(std::move(definition), _context);
         return _modules.back();
     }
 }
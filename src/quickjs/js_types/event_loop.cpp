@@ -0,0 +1,555 @@
+#include "event_loop.hpp"
+
+#if defined(__linux__)
+
+#include "../core/utils.hpp"
+#include "../exception/exception.hpp"
+#include "runtime.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace js
+{
+    namespace detail
+    {
+        namespace
+        {
+            constexpr uint64_t level_span(size_t level) noexcept
+            {
+                return uint64_t(1) << (TimerWheel::SLOT_BITS * level);
+            }
+        }
+
+        void TimerWheel::add(uint64_t id, uint64_t expires_ms)
+        {
+            // a timer that is already due fires on the next tick
+            uint64_t expires = std::max(expires_ms, _current + 1);
+            _expiry[id] = expires;
+            place({id, expires});
+        }
+
+        bool TimerWheel::cancel(uint64_t id)
+        {
+            return _expiry.erase(id) != 0;
+        }
+
+        void TimerWheel::place(const Entry& entry)
+        {
+            uint64_t delta = entry.expires > _current ? entry.expires - _current : 0;
+            for (size_t level = 0; level < LEVELS; ++level)
+            {
+                if (delta < level_span(level + 1))
+                {
+                    size_t slot = (entry.expires >> (SLOT_BITS * level)) & (SLOTS - 1);
+                    _wheels[level][slot].push_back(entry);
+                    return;
+                }
+            }
+
+            // beyond the top level: park it as far out as possible, it is placed again when that slot cascades
+            uint64_t parked = _current + level_span(LEVELS) - 1;
+            size_t slot = (parked >> (SLOT_BITS * (LEVELS - 1))) & (SLOTS - 1);
+            _wheels[LEVELS - 1][slot].push_back(entry);
+        }
+
+        void TimerWheel::cascade(size_t level)
+        {
+            size_t slot = (_current >> (SLOT_BITS * level)) & (SLOTS - 1);
+            std::vector<Entry> entries;
+            entries.swap(_wheels[level][slot]);
+            for (const Entry& entry : entries)
+            {
+                auto it = _expiry.find(entry.id);
+                if (it != _expiry.end() && it->second == entry.expires)
+                {
+                    place(entry);
+                }
+            }
+        }
+
+        void TimerWheel::advance(uint64_t now_ms, std::vector<uint64_t>& expired)
+        {
+            if (_expiry.empty())
+            {
+                // nothing live, drop stale entries and jump ahead
+                if (now_ms > _current)
+                {
+                    for (auto& wheel : _wheels)
+                    {
+                        for (auto& slot : wheel)
+                        {
+                            slot.clear();
+                        }
+                    }
+                    _current = now_ms;
+                }
+                return;
+            }
+
+            while (_current < now_ms)
+            {
+                ++_current;
+
+                // cascade every level whose boundary was crossed, highest first so entries can keep falling
+                size_t top = 0;
+                while (top + 1 < LEVELS && (_current & (level_span(top + 1) - 1)) == 0)
+                {
+                    ++top;
+                }
+                for (size_t level = top; level > 0; --level)
+                {
+                    cascade(level);
+                }
+
+                std::vector<Entry>& slot = _wheels[0][_current & (SLOTS - 1)];
+                if (slot.empty())
+                {
+                    continue;
+                }
+
+                std::vector<Entry> entries;
+                entries.swap(slot);
+                for (const Entry& entry : entries)
+                {
+                    auto it = _expiry.find(entry.id);
+                    if (it == _expiry.end() || it->second != entry.expires)
+                    {
+                        continue; // cancelled or rescheduled
+                    }
+                    if (entry.expires <= _current)
+                    {
+                        _expiry.erase(it);
+                        expired.push_back(entry.id);
+                    }
+                    else
+                    {
+                        place(entry);
+                    }
+                }
+            }
+        }
+
+        int64_t TimerWheel::next_timeout() const
+        {
+            if (_expiry.empty())
+            {
+                return -1;
+            }
+
+            for (uint64_t offset = 1; offset < SLOTS; ++offset)
+            {
+                uint64_t tick = _current + offset;
+                for (const Entry& entry : _wheels[0][tick & (SLOTS - 1)])
+                {
+                    auto it = _expiry.find(entry.id);
+                    if (it != _expiry.end() && it->second == entry.expires && entry.expires == tick)
+                    {
+                        return static_cast<int64_t>(offset);
+                    }
+                }
+            }
+
+            // nothing due on the lowest level, wake up for the next cascade
+            return static_cast<int64_t>(SLOTS - (_current & (SLOTS - 1)));
+        }
+    }
+
+    EventLoop::EventLoop(Context& context) : _context(context), _wheel(now_ms())
+    {
+        _epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        _wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        _timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+        auto add = [this](int fd)
+        {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            return epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+        };
+        if (_epoll_fd < 0 || _wake_fd < 0 || _timer_fd < 0 || !add(_wake_fd) || !add(_timer_fd))
+        {
+            std::string reason = std::strerror(errno);
+            if (_timer_fd >= 0) close(_timer_fd);
+            if (_wake_fd >= 0) close(_wake_fd);
+            if (_epoll_fd >= 0) close(_epoll_fd);
+            _timer_fd = _wake_fd = _epoll_fd = -1;
+            console::error("EventLoop: failed to set up epoll: %s", reason.c_str());
+            QUICKJS_IF_EXCEPTIONS(throw Exception("Failed to set up epoll: " + reason, context.get_context_handle()));
+            return;
+        }
+
+        detail::RuntimeData* data = detail::runtime_data(_context.get_context_handle());
+        if (data)
+        {
+            if (data->event_loop)
+            {
+                console::warn("EventLoop: runtime is already driven by another loop, replacing it");
+            }
+            data->event_loop = this;
+        }
+        install_timer_functions();
+    }
+
+    EventLoop::~EventLoop()
+    {
+        // JS timers hold values of the context
+        _timers.clear();
+        _watchers.clear();
+
+        detail::RuntimeData* data = detail::runtime_data(_context.get_context_handle());
+        if (data && data->event_loop == this)
+        {
+            data->event_loop = nullptr;
+        }
+
+        if (_timer_fd >= 0) close(_timer_fd);
+        if (_wake_fd >= 0) close(_wake_fd);
+        if (_epoll_fd >= 0) close(_epoll_fd);
+    }
+
+    uint64_t EventLoop::now_ms() noexcept
+    {
+        using namespace std::chrono;
+        return static_cast<uint64_t>(duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+    }
+
+    void EventLoop::run() QUICKJS_MAYBE_NOEXCEPT
+    {
+        while (!_stopped.load(std::memory_order_acquire) && run_once())
+        {
+        }
+        _stopped.store(false, std::memory_order_release);
+    }
+
+    bool EventLoop::run_once(std::chrono::milliseconds timeout) QUICKJS_MAYBE_NOEXCEPT
+    {
+        if (_epoll_fd < 0)
+        {
+            return false;
+        }
+
+        run_posted();
+        _context.run_pending_jobs();
+        run_timers();
+
+        if (!alive())
+        {
+            return false;
+        }
+
+        int64_t wait_ms = timeout.count() < 0 ? -1 : static_cast<int64_t>(timeout.count());
+        bool posted = false;
+        {
+            std::lock_guard<std::mutex> lock(_posted_mutex);
+            posted = !_posted.empty();
+        }
+        if (posted || _context.has_pending_jobs())
+        {
+            wait_ms = 0;
+        }
+        else if (!_wheel.empty())
+        {
+            int64_t due = static_cast<int64_t>(_wheel.current()) + _wheel.next_timeout() - static_cast<int64_t>(now_ms());
+            due = std::max<int64_t>(due, 0);
+            wait_ms = wait_ms < 0 ? due : std::min(wait_ms, due);
+        }
+
+        constexpr int MAX_EVENTS = 64;
+        epoll_event events[MAX_EVENTS];
+        int count = epoll_wait(_epoll_fd, events, MAX_EVENTS, static_cast<int>(std::min<int64_t>(wait_ms, INT32_MAX)));
+        if (count < 0 && errno != EINTR)
+        {
+            std::string reason = std::strerror(errno);
+            console::error("EventLoop: epoll_wait failed: %s", reason.c_str());
+            QUICKJS_IF_EXCEPTIONS(throw Exception("epoll_wait failed: " + reason, _context.get_context_handle()));
+            return false;
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            int fd = events[i].data.fd;
+            if (fd == _wake_fd || fd == _timer_fd)
+            {
+                uint64_t value;
+                while (read(fd, &value, sizeof(value)) > 0)
+                {
+                }
+                continue;
+            }
+
+            auto it = _watchers.find(fd);
+            if (it == _watchers.end())
+            {
+                continue; // unwatched by an earlier callback
+            }
+            // keep the callback alive even if it unwatches itself
+            std::shared_ptr<FdCallback> callback = it->second;
+            (*callback)(events[i].events);
+            _context.run_pending_jobs();
+        }
+
+        run_posted();
+        run_timers();
+        _context.run_pending_jobs();
+        arm_timer_fd();
+        return alive();
+    }
+
+    void EventLoop::stop() noexcept
+    {
+        _stopped.store(true, std::memory_order_release);
+        wake();
+    }
+
+    void EventLoop::post(Callback callback)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_posted_mutex);
+            _posted.push_back(std::move(callback));
+        }
+        wake();
+    }
+
+    void EventLoop::wake() noexcept
+    {
+        if (_wake_fd >= 0)
+        {
+            uint64_t one = 1;
+            ssize_t ret = write(_wake_fd, &one, sizeof(one));
+            (void)ret; // the counter is already non-zero when this fails with EAGAIN
+        }
+    }
+
+    void EventLoop::run_posted()
+    {
+        std::vector<Callback> posted;
+        {
+            std::lock_guard<std::mutex> lock(_posted_mutex);
+            posted.swap(_posted);
+        }
+        for (auto& callback : posted)
+        {
+            callback();
+            _context.run_pending_jobs();
+        }
+    }
+
+    EventLoop::TimerId EventLoop::set_timeout(std::chrono::milliseconds delay, Callback callback)
+    {
+        return add_timer(static_cast<uint64_t>(std::max<int64_t>(delay.count(), 0)), 0, std::move(callback));
+    }
+
+    EventLoop::TimerId EventLoop::set_interval(std::chrono::milliseconds period, Callback callback)
+    {
+        uint64_t ms = static_cast<uint64_t>(std::max<int64_t>(period.count(), 1));
+        return add_timer(ms, ms, std::move(callback));
+    }
+
+    bool EventLoop::clear_timer(TimerId id)
+    {
+        _wheel.cancel(id);
+        return _timers.erase(id) != 0;
+    }
+
+    EventLoop::TimerId EventLoop::add_timer(uint64_t delay, uint64_t period, Callback callback)
+    {
+        TimerId id = _next_timer_id++;
+        _timers.emplace(id, Timer{std::make_shared<Callback>(std::move(callback)), period});
+        _wheel.add(id, now_ms() + delay);
+        arm_timer_fd();
+        return id;
+    }
+
+    void EventLoop::arm_timer_fd() noexcept
+    {
+        if (_timer_fd < 0)
+        {
+            return;
+        }
+
+        // steady_clock is CLOCK_MONOTONIC, an all-zero value disarms the timer
+        itimerspec spec{};
+        if (!_wheel.empty())
+        {
+            uint64_t due = _wheel.current() + static_cast<uint64_t>(_wheel.next_timeout());
+            spec.it_value.tv_sec = static_cast<time_t>(due / 1000);
+            spec.it_value.tv_nsec = static_cast<long>(due % 1000) * 1000000;
+        }
+        timerfd_settime(_timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+    }
+
+    void EventLoop::run_timers()
+    {
+        std::vector<uint64_t> expired;
+        expired.swap(_expired);
+        expired.clear();
+        _wheel.advance(now_ms(), expired);
+
+        for (uint64_t id : expired)
+        {
+            auto it = _timers.find(id);
+            if (it == _timers.end())
+            {
+                continue; // cleared by an earlier callback
+            }
+
+            std::shared_ptr<Callback> callback = it->second.callback;
+            if (it->second.period)
+            {
+                _wheel.add(id, _wheel.current() + it->second.period);
+            }
+            else
+            {
+                _timers.erase(it);
+            }
+
+            (*callback)();
+            _context.run_pending_jobs();
+        }
+
+        // keep the buffer for the next round
+        _expired.swap(expired);
+    }
+
+    bool EventLoop::watch_fd(int fd, uint32_t events, FdCallback callback)
+    {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+
+        int op = _watchers.count(fd) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+        if (epoll_ctl(_epoll_fd, op, fd, &event) < 0)
+        {
+            console::error("EventLoop: failed to watch fd %d: %s", fd, std::strerror(errno));
+            return false;
+        }
+        _watchers[fd] = std::make_shared<FdCallback>(std::move(callback));
+        return true;
+    }
+
+    bool EventLoop::unwatch_fd(int fd)
+    {
+        auto it = _watchers.find(fd);
+        if (it == _watchers.end())
+        {
+            return false;
+        }
+        _watchers.erase(it);
+        // the fd may already be closed, which removed it from the epoll set
+        epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        return true;
+    }
+
+    void EventLoop::report_exception()
+    {
+        JSContext* ctx = _context.get_context_handle();
+        if (_context._on_exception)
+        {
+            _context._on_exception(ctx);
+        }
+        else
+        {
+            JS_FreeValue(ctx, JS_GetException(ctx));
+        }
+    }
+
+    bool EventLoop::alive() const
+    {
+        if (!_timers.empty() || !_watchers.empty() || _context.has_pending_jobs())
+        {
+            return true;
+        }
+        std::lock_guard<std::mutex> lock(_posted_mutex);
+        return !_posted.empty();
+    }
+
+    void EventLoop::install_timer_functions()
+    {
+        JSContext* ctx = _context.get_context_handle();
+        JSValue global = JS_GetGlobalObject(ctx);
+        JS_SetPropertyStr(ctx, global, "setTimeout", JS_NewCFunction(ctx, &EventLoop::js_set_timeout, "setTimeout", 2));
+        JS_SetPropertyStr(ctx, global, "setInterval", JS_NewCFunction(ctx, &EventLoop::js_set_interval, "setInterval", 2));
+        JS_SetPropertyStr(ctx, global, "clearTimeout", JS_NewCFunction(ctx, &EventLoop::js_clear_timer, "clearTimeout", 1));
+        JS_SetPropertyStr(ctx, global, "clearInterval", JS_NewCFunction(ctx, &EventLoop::js_clear_timer, "clearInterval", 1));
+        JS_FreeValue(ctx, global);
+    }
+
+    JSValue EventLoop::set_js_timer(JSContext* ctx, int argc, JSValueConst* argv, bool repeat)
+    {
+        detail::RuntimeData* data = detail::runtime_data(ctx);
+        EventLoop* loop = data ? data->event_loop : nullptr;
+        if (!loop)
+        {
+            return JS_ThrowTypeError(ctx, "no event loop is driving this runtime");
+        }
+        if (argc < 1 || !JS_IsFunction(ctx, argv[0]))
+        {
+            return JS_ThrowTypeError(ctx, "callback is not a function");
+        }
+
+        double delay = 0;
+        if (argc > 1 && JS_ToFloat64(ctx, &delay, argv[1]) < 0)
+        {
+            return JS_EXCEPTION;
+        }
+        if (!std::isfinite(delay) || delay < 0)
+        {
+            delay = 0;
+        }
+
+        Value fn(ctx, JS_DupValue(ctx, argv[0]));
+        std::vector<Value> args;
+        for (int i = 2; i < argc; ++i)
+        {
+            args.emplace_back(ctx, JS_DupValue(ctx, argv[i]));
+        }
+
+        // a throwing callback is reported on its own and does not stop the loop
+        Callback callback = [loop, fn = std::move(fn), args = std::move(args)]()
+        {
+            Value result = fn.call(args);
+            if (JS_IsException(result._val))
+            {
+                loop->report_exception();
+            }
+        };
+
+        auto ms = std::chrono::milliseconds(static_cast<int64_t>(delay));
+        TimerId id = repeat ? loop->set_interval(ms, std::move(callback)) : loop->set_timeout(ms, std::move(callback));
+        return JS_NewInt64(ctx, static_cast<int64_t>(id));
+    }
+
+    JSValue EventLoop::js_set_timeout(JSContext* ctx, JSValueConst, int argc, JSValueConst* argv)
+    {
+        return set_js_timer(ctx, argc, argv, false);
+    }
+
+    JSValue EventLoop::js_set_interval(JSContext* ctx, JSValueConst, int argc, JSValueConst* argv)
+    {
+        return set_js_timer(ctx, argc, argv, true);
+    }
+
+    JSValue EventLoop::js_clear_timer(JSContext* ctx, JSValueConst, int argc, JSValueConst* argv)
+    {
+        detail::RuntimeData* data = detail::runtime_data(ctx);
+        EventLoop* loop = data ? data->event_loop : nullptr;
+        int64_t id = 0;
+        if (loop && argc > 0 && JS_ToInt64(ctx, &id, argv[0]) == 0 && id > 0)
+        {
+            loop->clear_timer(static_cast<TimerId>(id));
+        }
+        return JS_UNDEFINED;
+    }
+}
+
+#endif
@@ -0,0 +1,231 @@
+#include "executor.hpp"
+
+#include "../core/utils.hpp"
+#include "../exception/exception.hpp"
+#include "runtime.hpp"
+
+#include <mutex>
+
+namespace js
+{
+    namespace
+    {
+        // the worker the current thread belongs to, used to keep nested submissions local
+        thread_local const Executor* tls_executor = nullptr;
+        thread_local size_t tls_worker_index = 0;
+    }
+
+    namespace detail
+    {
+        std::exception_ptr take_pending_exception(JSContext* ctx, const std::string& what)
+        {
+            return std::make_exception_ptr(Exception(take_exception_message(ctx, what.c_str()), ctx));
+        }
+
+        void WorkStealingQueue::push(std::unique_ptr<ExecutorTask> task)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _tasks.push_back(std::move(task));
+        }
+
+        std::unique_ptr<ExecutorTask> WorkStealingQueue::pop()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_tasks.empty()) return nullptr;
+            auto task = std::move(_tasks.back());
+            _tasks.pop_back();
+            return task;
+        }
+
+        std::unique_ptr<ExecutorTask> WorkStealingQueue::steal()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_tasks.empty()) return nullptr;
+            auto task = std::move(_tasks.front());
+            _tasks.pop_front();
+            return task;
+        }
+    }
+
+    Executor::Executor(ExecutorOptions options) : _options(std::move(options))
+    {
+        size_t count = _options.threads;
+        if (count == 0)
+        {
+            count = std::thread::hardware_concurrency();
+        }
+        if (count == 0)
+        {
+            count = 1;
+        }
+
+        _workers.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            _workers.push_back(std::make_unique<Worker>());
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            _workers[i]->thread = std::thread(&Executor::worker_main, this, i);
+        }
+    }
+
+    Executor::~Executor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_sleep_mutex);
+            _stopping = true;
+        }
+        _sleep_cv.notify_all();
+
+        for (auto& worker : _workers)
+        {
+            if (worker->thread.joinable())
+            {
+                worker->thread.join();
+            }
+        }
+    }
+
+    void Executor::register_script(const std::string& id, const std::string& source)
+    {
+        std::unique_lock<std::shared_mutex> lock(_scripts_mutex);
+        _scripts[id] = Script{source, ++_script_generation};
+    }
+
+    ExecutorStats Executor::stats() const noexcept
+    {
+        return ExecutorStats{_executed.load(std::memory_order_relaxed), _failed.load(std::memory_order_relaxed),
+                             _stolen.load(std::memory_order_relaxed)};
+    }
+
+    void Executor::enqueue(std::unique_ptr<detail::ExecutorTask> task)
+    {
+        // tasks submitted from a worker stay on that worker, others are spread round-robin
+        size_t index = tls_executor == this ? tls_worker_index
+                                            : _next_queue.fetch_add(1, std::memory_order_relaxed) % _workers.size();
+
+        _workers[index]->queue.push(std::move(task));
+
+        {
+            // a worker that scanned the queues before the push sees the counter move and does not sleep
+            std::lock_guard<std::mutex> lock(_sleep_mutex);
+            _enqueued.fetch_add(1, std::memory_order_release);
+        }
+        _sleep_cv.notify_one();
+    }
+
+    std::unique_ptr<detail::ExecutorTask> Executor::next_task(size_t index)
+    {
+        if (auto task = _workers[index]->queue.pop())
+        {
+            return task;
+        }
+
+        for (size_t i = 1; i < _workers.size(); ++i)
+        {
+            if (auto task = _workers[(index + i) % _workers.size()]->queue.steal())
+            {
+                _stolen.fetch_add(1, std::memory_order_relaxed);
+                return task;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void Executor::worker_main(size_t index)
+    {
+        tls_executor = this;
+        tls_worker_index = index;
+
+        // the runtime is created and used on this thread only
+        std::unique_ptr<Runtime> runtime;
+        std::unique_ptr<Context> context;
+        std::exception_ptr init_error;
+        try
+        {
+            runtime = std::make_unique<Runtime>();
+            context = std::make_unique<Context>(*runtime);
+            context->enable_bytecode_cache(_bytecode_cache);
+            if (_options.setup)
+            {
+                _options.setup(*context);
+            }
+        }
+        catch (...)
+        {
+            console::error("Executor: failed to initialize worker %zu", index);
+            init_error = std::current_exception();
+        }
+
+        struct CachedScript
+        {
+            uint64_t generation;
+            Value func;
+        };
+        std::unordered_map<std::string, CachedScript> functions;
+
+        for (;;)
+        {
+            uint64_t seen = _enqueued.load(std::memory_order_acquire);
+            std::unique_ptr<detail::ExecutorTask> task = next_task(index);
+            if (!task)
+            {
+                std::unique_lock<std::mutex> lock(_sleep_mutex);
+                if (_stopping)
+                {
+                    // the queues are drained, tasks submitted by a running task stay on its own worker
+                    break;
+                }
+                // sleep until something is pushed after the scan above, not merely while tasks are queued
+                _sleep_cv.wait(lock, [&] { return _stopping || _enqueued.load(std::memory_order_relaxed) != seen; });
+                continue;
+            }
+
+            if (init_error)
+            {
+                task->fail(init_error);
+                _failed.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            bool ok = false;
+            try
+            {
+                Script script;
+                {
+                    std::shared_lock<std::shared_mutex> lock(_scripts_mutex);
+                    auto it = _scripts.find(task->script_id());
+                    if (it == _scripts.end())
+                    {
+                        throw Exception("Unknown script id: " + task->script_id());
+                    }
+                    script = it->second;
+                }
+
+                auto cached = functions.find(task->script_id());
+                if (cached == functions.end() || cached->second.generation != script.generation)
+                {
+                    Value func = context->eval(script.source, task->script_id());
+                    if (!func.is_function())
+                    {
+                        throw Exception("Script \"" + task->script_id() + "\" did not evaluate to a function");
+                    }
+                    cached = functions.insert_or_assign(task->script_id(), CachedScript{script.generation, std::move(func)}).first;
+                }
+
+                ok = task->run(context->get_context_handle(), cached->second.func.js_value());
+            }
+            catch (...)
+            {
+                task->fail(std::current_exception());
+            }
+
+            (ok ? _executed : _failed).fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // values must go before the context that owns them
+        functions.clear();
+    }
+}
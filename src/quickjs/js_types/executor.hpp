@@ -0,0 +1,219 @@
+#pragma once
+
+#include "../core/macros.hpp"
+#include "../detail/type_converter.hpp"
+#include "../detail/type_traits.hpp"
+#include "bytecode_cache.hpp"
+#include "context.hpp"
+#include "value.hpp"
+
+#include <quickjs.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace js
+{
+    namespace detail
+    {
+        // build a js::Exception from the pending exception of `ctx`, see take_exception_message
+        std::exception_ptr take_pending_exception(JSContext* ctx, const std::string& what);
+
+        // task arguments are stored by value, C strings are copied so they outlive the caller
+        template <typename T>
+        using task_arg_t = std::conditional_t<std::is_same_v<std::decay_t<T>, const char*> || std::is_same_v<std::decay_t<T>, char*>,
+                                              std::string, std::decay_t<T>>;
+
+        // type-erased unit of work run by an Executor worker
+        class ExecutorTask
+        {
+        public:
+            explicit ExecutorTask(std::string script_id) : _script_id(std::move(script_id)) {}
+            virtual ~ExecutorTask() = default;
+
+            const std::string& script_id() const noexcept { return _script_id; }
+
+            // call `func` (the evaluated script) in the worker context, returns false when the task failed
+            virtual bool run(JSContext* ctx, JSValueConst func) noexcept = 0;
+
+            // complete the task without running it
+            virtual void fail(std::exception_ptr error) noexcept = 0;
+
+        private:
+            std::string _script_id;
+        };
+
+        template <typename R, typename... Args>
+        class ScriptTask final : public ExecutorTask
+        {
+        public:
+            static_assert(!std::is_same_v<R, Value>, "js::Value cannot leave the runtime of its worker, return a plain C++ type");
+
+            ScriptTask(std::string script_id, std::promise<R> promise, Args... args)
+                : ExecutorTask(std::move(script_id)), _promise(std::move(promise)), _args(std::move(args)...)
+            {
+            }
+
+            bool run(JSContext* ctx, JSValueConst func) noexcept override
+            {
+                try
+                {
+                    JSValue result = std::apply(
+                        [&](const Args&... args)
+                        {
+                            CallArgs<sizeof...(Args)> argv(ctx);
+                            (argv.push(TypeConverter<Args>::to_js(ctx, args)), ...);
+                            return JS_Call(ctx, func, JS_UNDEFINED, static_cast<int>(sizeof...(Args)), argv.data());
+                        },
+                        _args);
+
+                    if (JS_IsException(result))
+                    {
+                        _promise.set_exception(take_pending_exception(ctx, "Script \"" + script_id() + "\" threw"));
+                        return false;
+                    }
+
+                    if constexpr (std::is_void_v<R>)
+                    {
+                        JS_FreeValue(ctx, result);
+                        _promise.set_value();
+                    }
+                    else
+                    {
+                        _promise.set_value(unwrap_free<R>(ctx, result));
+                    }
+                    return true;
+                }
+                catch (...)
+                {
+                    _promise.set_exception(std::current_exception());
+                    return false;
+                }
+            }
+
+            void fail(std::exception_ptr error) noexcept override
+            {
+                _promise.set_exception(std::move(error));
+            }
+
+        private:
+            std::promise<R> _promise;
+            std::tuple<Args...> _args;
+        };
+
+        // A per-worker task deque: the owner pushes and pops at the back (LIFO, cache-warm),
+        // idle workers steal from the front (oldest task first).
+        class WorkStealingQueue
+        {
+        public:
+            void push(std::unique_ptr<ExecutorTask> task);
+            std::unique_ptr<ExecutorTask> pop();
+            std::unique_ptr<ExecutorTask> steal();
+
+        private:
+            std::mutex _mutex;
+            std::deque<std::unique_ptr<ExecutorTask>> _tasks;
+        };
+    }
+
+    struct ExecutorOptions
+    {
+        // number of worker threads, each owning one Runtime/Context (0 = hardware concurrency)
+        size_t threads = 0;
+
+        // invoked once on every worker context, e.g. to register modules
+        std::function<void(Context&)> setup;
+    };
+
+    struct ExecutorStats
+    {
+        uint64_t executed = 0; // tasks that completed with a value
+        uint64_t failed = 0;   // tasks that threw or could not run
+        uint64_t stolen = 0;
+    };
+
+    // Runs registered scripts on a fixed set of worker threads, one Runtime per worker.
+    // A script is evaluated once per worker (its bytecode is compiled once and shared) and must
+    // evaluate to a function; tasks call that function with their arguments converted through TypeConverter.
+    class Executor
+    {
+    public:
+        explicit Executor(ExecutorOptions options = {});
+
+        // finishes all queued tasks, then joins the workers
+        ~Executor();
+
+        Executor(const Executor&) = delete;
+        Executor& operator=(const Executor&) = delete;
+
+        // register (or replace) the script run by tasks submitted with `id`
+        void register_script(const std::string& id, const std::string& source);
+
+        // call the function produced by script `id` with `args` on some worker.
+        // The arguments are copied into the task and converted to JS on the worker thread.
+        template <typename R, typename... Args>
+        std::future<R> submit(const std::string& id, Args&&... args)
+        {
+            std::promise<R> promise;
+            std::future<R> future = promise.get_future();
+            enqueue(std::make_unique<detail::ScriptTask<R, detail::task_arg_t<Args>...>>(id, std::move(promise), std::forward<Args>(args)...));
+            return future;
+        }
+
+        size_t threads() const noexcept { return _workers.size(); }
+
+        ExecutorStats stats() const noexcept;
+
+    private:
+        struct Script
+        {
+            std::string source;
+            uint64_t generation;
+        };
+
+        struct Worker
+        {
+            detail::WorkStealingQueue queue;
+            std::thread thread;
+        };
+
+        void enqueue(std::unique_ptr<detail::ExecutorTask> task);
+        std::unique_ptr<detail::ExecutorTask> next_task(size_t index);
+        void worker_main(size_t index);
+
+    private:
+        ExecutorOptions _options;
+        std::vector<std::unique_ptr<Worker>> _workers;
+        std::shared_ptr<BytecodeCache> _bytecode_cache{std::make_shared<BytecodeCache>()};
+
+        mutable std::shared_mutex _scripts_mutex;
+        std::unordered_map<std::string, Script> _scripts;
+        uint64_t _script_generation{0};
+
+        std::mutex _sleep_mutex;
+        std::condition_variable _sleep_cv;
+        std::atomic<uint64_t> _enqueued{0}; // bumped under _sleep_mutex after each push
+        std::atomic<bool> _stopping{false};
+        std::atomic<size_t> _next_queue{0};
+
+        std::atomic<uint64_t> _executed{0};
+        std::atomic<uint64_t> _failed{0};
+        std::atomic<uint64_t> _stolen{0};
+    };
+}
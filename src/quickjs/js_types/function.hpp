@@ -0,0 +1,160 @@
+#pragma once
+
+#include "../core/macros.hpp"
+#include "../core/utils.hpp"
+#include "../detail/type_converter.hpp"
+#include "../exception/exception.hpp"
+#include "value.hpp"
+
+#include <quickjs.h>
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace js
+{
+    template <typename Signature>
+    class Function;
+
+    // owning handle to a JS function with a fixed C++ signature.
+    // Arity is checked once when binding; invoking converts the arguments into a stack array.
+    template <typename R, typename... Args>
+    class Function<R(Args...)>
+    {
+    public:
+        Function() noexcept = default;
+
+        // bind `value`, which must be a function declaring at most sizeof...(Args) parameters
+        explicit Function(const Value& value) QUICKJS_MAYBE_NOEXCEPT
+        {
+            if (!value.is_function())
+            {
+                console::error("Function: value is not a function");
+                QUICKJS_IF_EXCEPTIONS(throw Exception("Value is not a function", value._ctx));
+                return;
+            }
+
+            int32_t length = value[QUICKJS_ATOM("length")].to_int32();
+            if (length > static_cast<int32_t>(sizeof...(Args)))
+            {
+                console::error("Function: JS function expects %d arguments, signature provides %d", length,
+                               static_cast<int>(sizeof...(Args)));
+                QUICKJS_IF_EXCEPTIONS(throw Exception("JS function expects more arguments than the bound signature provides", value._ctx));
+                return;
+            }
+
+            _ctx = value._ctx;
+            _fn = JS_DupValue(_ctx, value._val);
+            _arity = length;
+        }
+
+        Function(const Function& other) noexcept
+            : _ctx(other._ctx), _fn(other._ctx ? JS_DupValue(other._ctx, other._fn) : JS_UNDEFINED), _arity(other._arity)
+        {
+        }
+
+        Function& operator=(const Function& other) noexcept
+        {
+            if (this != &other)
+            {
+                Function copy(other);
+                swap(copy);
+            }
+            return *this;
+        }
+
+        Function(Function&& other) noexcept : _ctx(other._ctx), _fn(other._fn), _arity(other._arity)
+        {
+            other._ctx = nullptr;
+            other._fn = JS_UNDEFINED;
+        }
+
+        Function& operator=(Function&& other) noexcept
+        {
+            if (this != &other)
+            {
+                Function moved(std::move(other));
+                swap(moved);
+            }
+            return *this;
+        }
+
+        ~Function()
+        {
+            if (_ctx)
+            {
+                JS_FreeValue(_ctx, _fn);
+            }
+        }
+
+        bool is_valid() const noexcept { return _ctx != nullptr; }
+        explicit operator bool() const noexcept { return is_valid(); }
+
+        // number of parameters declared by the JS function
+        int arity() const noexcept { return _arity; }
+
+        // the bound function as a Value
+        Value value() const { return _ctx ? Value(_ctx, JS_DupValue(_ctx, _fn)) : Value(); }
+
+        // call the function, arguments are converted like Value::call's (js::Value arguments are passed through).
+        // Calling an unbound Function is reported and raised as js::Exception.
+        R operator()(Args... args) const
+        {
+            if (!_ctx)
+            {
+                console::error("Function: calling an unbound function");
+                QUICKJS_IF_EXCEPTIONS(throw Exception("Calling an unbound js::Function"));
+                return failed();
+            }
+
+            JSValue result;
+            if constexpr (sizeof...(Args) == 0)
+            {
+                result = JS_Call(_ctx, _fn, JS_UNDEFINED, 0, nullptr);
+            }
+            else
+            {
+                detail::CallArgs<sizeof...(Args)> js_args(_ctx);
+                (js_args.push(Value::to_call_arg(_ctx, args)), ...);
+                result = JS_Call(_ctx, _fn, JS_UNDEFINED, static_cast<int>(sizeof...(Args)), js_args.data());
+            }
+
+            if (JS_IsException(result))
+            {
+                detail::raise_call_exception(_ctx);
+                return failed();
+            }
+            if constexpr (std::is_same_v<R, Value>)
+            {
+                return Value(_ctx, result);
+            }
+            else
+            {
+                return detail::unwrap_free<R>(_ctx, result);
+            }
+        }
+
+        void swap(Function& other) noexcept
+        {
+            std::swap(_ctx, other._ctx);
+            std::swap(_fn, other._fn);
+            std::swap(_arity, other._arity);
+        }
+
+    private:
+        // result of a call that failed without throwing
+        static R failed()
+        {
+            if constexpr (!std::is_void_v<R>)
+            {
+                return R{};
+            }
+        }
+
+    private:
+        JSContext* _ctx{nullptr};
+        JSValue _fn{JS_UNDEFINED};
+        int _arity{0};
+    };
+}
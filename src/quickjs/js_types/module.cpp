@@ -1,20 +1,41 @@
 #include "module.hpp"
 
+#include "../core/utils.hpp"
+#include "runtime.hpp"
+
 namespace js
 {
-    // Static members defined in header as inline
-
-    Module::Module(const std::string& name, JSContext* ctx)
-        : _ctx(ctx), _mod(nullptr), _name(name)
+    Module::Module(const std::string& name, JSContext* ctx, ModuleLoading loading)
+        : _ctx(ctx), _mod(nullptr), _name(name), _loading(loading)
     {
-        current_module = this;
         _mod = JS_NewCModule(ctx, name.c_str(), module_init_callback);
+        attach();
+    }
+
+    Module::Module(std::shared_ptr<const ModuleDefinition> definition, JSContext* ctx)
+        : _ctx(ctx), _mod(nullptr), _name(definition->name()), _definition(std::move(definition))
+    {
+        _mod = JS_NewCModule(ctx, _name.c_str(), module_init_callback);
+        if (!_mod)
+        {
+            return;
+        }
+        attach();
+
+        const auto& functions = _definition->functions();
+        JS_AddModuleExportList(ctx, _mod, functions.data(), static_cast<int>(functions.size()));
+        for (const auto& entry : _definition->exports())
+        {
+            JS_AddModuleExport(ctx, _mod, entry.name.c_str());
+        }
     }
 
     Module::~Module()
     {
         if (!_ctx) return;
 
+        detach();
+
         for (auto& entry : _exports)
         {
             if (!JS_IsUndefined(entry.value))
@@ -25,16 +46,22 @@ namespace js
     }
 
     Module::Module(Module&& other) noexcept
-        : _ctx(other._ctx), _mod(other._mod), _name(std::move(other._name)), _exports(std::move(other._exports))
+        : _ctx(other._ctx), _mod(other._mod), _name(std::move(other._name)), _loading(other._loading),
+          _exports(std::move(other._exports)), _definition(std::move(other._definition))
     {
         other._ctx = nullptr;
         other._mod = nullptr;
+        attach();
     }
 
     Module& Module::operator=(Module&& other) noexcept
     {
         if (this != &other)
         {
+            if (_ctx)
+            {
+                detach();
+            }
             for (auto& entry : _exports)
             {
                 if (_ctx && !JS_IsUndefined(entry.value))
@@ -47,35 +74,141 @@ namespace js
             _ctx = other._ctx;
             _mod = other._mod;
             _name = std::move(other._name);
+            _loading = other._loading;
             _exports = std::move(other._exports);
+            _definition = std::move(other._definition);
             other._ctx = nullptr;
             other._mod = nullptr;
+            attach();
         }
         return *this;
     }
 
-    int Module::module_init_callback(JSContext* ctx, JSModuleDef* m)
+    void Module::attach() noexcept
+    {
+        detail::RuntimeData* data = detail::runtime_data(_ctx);
+        if (data && _mod)
+        {
+            data->modules[_mod] = this;
+        }
+    }
+
+    void Module::detach() noexcept
     {
-        (void)ctx;
-        (void)m;
+        detail::RuntimeData* data = detail::runtime_data(_ctx);
+        if (data && _mod)
+        {
+            auto it = data->modules.find(_mod);
+            if (it != data->modules.end() && it->second == this)
+            {
+                data->modules.erase(it);
+            }
+        }
+    }
 
-        if (!current_module)
+    int Module::module_init_callback(JSContext* ctx, JSModuleDef* m)
+    {
+        Module* found = nullptr;
+        if (detail::RuntimeData* data = detail::runtime_data(ctx))
+        {
+            auto it = data->modules.find(m);
+            found = it != data->modules.end() ? it->second : nullptr;
+        }
+        if (!found)
         {
+            console::error("Module: no native module registered for the module being imported");
             return -1;
         }
+        Module& module = *found;
+
+        if (module._definition)
+        {
+            const ModuleDefinition& definition = *module._definition;
+            const auto& functions = definition.functions();
+            if (JS_SetModuleExportList(ctx, m, functions.data(), static_cast<int>(functions.size())) < 0)
+            {
+                return -1;
+            }
+            for (const auto& entry : definition.exports())
+            {
+                JSValue val = instantiate(ctx, entry);
+                if (JS_IsException(val))
+                {
+                    return -1;
+                }
+                JS_SetModuleExport(ctx, m, entry.name.c_str(), val);
+            }
+            return 0;
+        }
 
-        for (auto& entry : current_module->_exports)
+        for (auto& entry : module._exports)
         {
-            JSValue val = JS_DupValue(current_module->_ctx, entry.value);
-            JS_SetModuleExport(current_module->_ctx, current_module->_mod, entry.name.c_str(), val);
+            JSValue val = module.is_lazy() ? instantiate(ctx, entry) : JS_DupValue(ctx, entry.value);
+            if (JS_IsException(val))
+            {
+                return -1;
+            }
+            JS_SetModuleExport(ctx, m, entry.name.c_str(), val);
         }
 
         return 0;
     }
 
+    JSValue Module::instantiate(JSContext* ctx, const detail::ModuleExportEntry& entry)
+    {
+        if (entry.func)
+        {
+            return JS_NewCFunction(ctx, entry.func, entry.name.c_str(), entry.length);
+        }
+        if (!entry.factory)
+        {
+            // a value added with add_export(name, JSValue), which the module owns
+            return JS_DupValue(ctx, entry.value);
+        }
+
+        try
+        {
+            return entry.factory(ctx);
+        }
+        catch (const std::exception& e)
+        {
+            console::error("Module: failed to create export '%s': %s", entry.name.c_str(), e.what());
+            JS_ThrowInternalError(ctx, "Failed to create module export '%s': %s", entry.name.c_str(), e.what());
+            return JS_EXCEPTION;
+        }
+        catch (...)
+        {
+            console::error("Module: failed to create export '%s': unknown C++ exception", entry.name.c_str());
+            JS_ThrowInternalError(ctx, "Failed to create module export '%s': unknown C++ exception", entry.name.c_str());
+            return JS_EXCEPTION;
+        }
+    }
+
     void Module::add_export(const std::string& name, JSValue value)
     {
         JS_AddModuleExport(_ctx, _mod, name.c_str());
         _exports.push_back({name, value});
     }
-}
+
+    void Module::add_export(const std::string& name, std::function<JSValue(JSContext*)> factory)
+    {
+        if (!is_lazy())
+        {
+            add_export(name, factory(_ctx));
+            return;
+        }
+
+        JS_AddModuleExport(_ctx, _mod, name.c_str());
+        detail::ModuleExportEntry entry{name, JS_UNDEFINED};
+        entry.factory = std::move(factory);
+        _exports.push_back(std::move(entry));
+    }
+
+    ModuleDefinition& ModuleDefinition::add_export(const std::string& name, std::function<JSValue(JSContext*)> factory)
+    {
+        detail::ModuleExportEntry entry{name, JS_UNDEFINED};
+        entry.factory = std::move(factory);
+        _exports.push_back(std::move(entry));
+        return *this;
+    }
+}
\ No newline at end of file
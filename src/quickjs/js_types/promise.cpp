@@ -0,0 +1,342 @@
+#include "promise.hpp"
+
+#include "../core/utils.hpp"
+#include "../exception/exception.hpp"
+#include "runtime.hpp"
+
+#include <exception>
+#include <memory>
+
+namespace js
+{
+    namespace detail
+    {
+        size_t run_pending_jobs(JSRuntime* rt, size_t max_jobs) QUICKJS_MAYBE_NOEXCEPT
+        {
+            size_t executed = 0;
+            while (max_jobs == 0 || executed < max_jobs)
+            {
+                JSContext* job_ctx = nullptr;
+                int ret = JS_ExecutePendingJob(rt, &job_ctx);
+                if (ret == 0)
+                {
+                    break;
+                }
+
+                ++executed;
+                if (ret < 0)
+                {
+                    raise_call_exception(job_ctx, "Pending JS job threw");
+                }
+            }
+            return executed;
+        }
+    }
+
+    PromiseState Promise::state() const noexcept
+    {
+        if (!_value._ctx || !JS_IsPromise(_value._val))
+        {
+            return PromiseState::FULFILLED;
+        }
+        return static_cast<PromiseState>(JS_PromiseState(_value._ctx, _value._val));
+    }
+
+    Value Promise::result() const
+    {
+        JSContext* ctx = _value._ctx;
+        if (!ctx)
+        {
+            return Value();
+        }
+        if (!JS_IsPromise(_value._val))
+        {
+            return _value;
+        }
+
+        PromiseState current = state();
+        if (current == PromiseState::PENDING)
+        {
+            return Value(ctx, JS_UNDEFINED);
+        }
+
+        Value result(ctx, JS_PromiseResult(ctx, _value._val));
+        if (_unwrap && current == PromiseState::FULFILLED)
+        {
+            return result["value"];
+        }
+        return result;
+    }
+
+    bool Promise::wait() const QUICKJS_MAYBE_NOEXCEPT
+    {
+        if (!_value._ctx)
+        {
+            return false;
+        }
+
+        JSRuntime* rt = JS_GetRuntime(_value._ctx);
+        while (!is_settled())
+        {
+            if (detail::run_pending_jobs(rt, 1) == 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Value Promise::get() const QUICKJS_MAYBE_NOEXCEPT
+    {
+        if (!wait())
+        {
+            console::error("Promise did not settle, no pending jobs left");
+            QUICKJS_IF_EXCEPTIONS(throw Exception("Promise did not settle, no pending jobs left", _value._ctx));
+            return Value(_value._ctx, JS_UNDEFINED);
+        }
+
+        Value value = result();
+        if (state() == PromiseState::REJECTED)
+        {
+            std::string message = "Promise rejected: " + value.to_string();
+            console::error("%s", message.c_str());
+            QUICKJS_IF_EXCEPTIONS(throw Exception(message, _value._ctx));
+            return Value(_value._ctx, JS_UNDEFINED);
+        }
+        return value;
+    }
+
+    namespace
+    {
+        using SettledCallback = std::function<void(const Value&, bool)>;
+
+        void finalize_callback(JSRuntime*, JSValue obj) noexcept
+        {
+            delete static_cast<SettledCallback*>(JS_GetOpaque(obj, JS_GetClassID(obj)));
+        }
+
+        // class of the objects owning a native callback, registered once per runtime. The callback is
+        // released by the finalizer, including when the promise is collected without ever settling.
+        JSClassID callback_class(JSContext* ctx)
+        {
+            detail::RuntimeData* data = detail::runtime_data(ctx);
+            if (!data)
+            {
+                return JS_INVALID_CLASS_ID;
+            }
+            if (data->callback_class == JS_INVALID_CLASS_ID)
+            {
+                JSRuntime* rt = JS_GetRuntime(ctx);
+                JSClassID class_id = JS_INVALID_CLASS_ID;
+                JS_NewClassID(rt, &class_id);
+
+                JSClassDef def = {"NativeCallback", &finalize_callback, nullptr, nullptr, nullptr};
+                if (JS_NewClass(rt, class_id, &def) < 0)
+                {
+                    return JS_INVALID_CLASS_ID;
+                }
+                data->callback_class = class_id;
+            }
+            return data->callback_class;
+        }
+
+        // then() handler, magic is 1 for rejections. Both handlers share the callback owner passed as
+        // function data, only one of them ever runs and it takes the callback out.
+        JSValue settled_handler(JSContext* ctx, JSValueConst, int argc, JSValueConst* argv, int magic, JSValue* data)
+        {
+            auto* owned = static_cast<SettledCallback*>(JS_GetOpaque(data[0], JS_GetClassID(data[0])));
+            if (!owned || !*owned)
+            {
+                return JS_UNDEFINED;
+            }
+            SettledCallback callback = std::move(*owned);
+            *owned = nullptr;
+
+            Value result(ctx, argc > 0 ? JS_DupValue(ctx, argv[0]) : JS_UNDEFINED);
+            try
+            {
+                callback(result, magic != 0);
+            }
+            catch (const std::exception& e)
+            {
+                return JS_ThrowInternalError(ctx, "%s", e.what());
+            }
+            catch (...)
+            {
+                return JS_ThrowInternalError(ctx, "Unknown C++ exception");
+            }
+            return JS_UNDEFINED;
+        }
+    }
+
+    void Promise::on_settled(std::function<void(const Value& result, bool rejected)> callback) const QUICKJS_MAYBE_NOEXCEPT
+    {
+        JSContext* ctx = _value._ctx;
+        if (!ctx || !JS_IsPromise(_value._val))
+        {
+            callback(_value, false);
+            return;
+        }
+
+        JSClassID class_id = callback_class(ctx);
+        if (class_id == JS_INVALID_CLASS_ID)
+        {
+            console::error("Promise::on_settled: the context was not created from a js::Runtime");
+            QUICKJS_IF_EXCEPTIONS(throw Exception("Promise callbacks require a context created from a js::Runtime", ctx));
+            return;
+        }
+
+        JSValue owner = JS_NewObjectClass(ctx, class_id);
+        if (JS_IsException(owner))
+        {
+            detail::raise_call_exception(ctx, "Failed to attach promise handlers");
+            return;
+        }
+
+        bool unwrap = _unwrap;
+        JS_SetOpaque(owner, new SettledCallback(
+                                [unwrap, callback = std::move(callback)](const Value& result, bool rejected)
+                                {
+                                    callback(unwrap && !rejected ? result["value"] : result, rejected);
+                                }));
+
+        JSValue handlers[2] = {JS_NewCFunctionData(ctx, &settled_handler, 1, 0, 1, &owner),
+                               JS_NewCFunctionData(ctx, &settled_handler, 1, 1, 1, &owner)};
+        JS_FreeValue(ctx, owner);
+        if (JS_IsException(handlers[0]) || JS_IsException(handlers[1]))
+        {
+            JS_FreeValue(ctx, handlers[0]);
+            JS_FreeValue(ctx, handlers[1]);
+            detail::raise_call_exception(ctx, "Failed to attach promise handlers");
+            return;
+        }
+
+        JSValue then = JS_GetPropertyStr(ctx, _value._val, "then");
+        JSValue ret = JS_Call(ctx, then, _value._val, 2, handlers);
+        JS_FreeValue(ctx, then);
+        JS_FreeValue(ctx, handlers[0]);
+        JS_FreeValue(ctx, handlers[1]);
+
+        if (JS_IsException(ret))
+        {
+            detail::raise_call_exception(ctx, "Failed to attach promise handlers");
+            return;
+        }
+        JS_FreeValue(ctx, ret);
+    }
+
+    JSValue Promise::dup_value() const noexcept
+    {
+        return _value._ctx ? JS_DupValue(_value._ctx, _value._val) : JS_UNDEFINED;
+    }
+
+    namespace detail
+    {
+        JSValue TypeConverter<Promise>::to_js(JSContext* ctx, const Promise& value)
+        {
+            (void)ctx;
+            return value.dup_value();
+        }
+
+        Promise TypeConverter<Promise>::from_js(JSContext* ctx, JSValueConst value)
+        {
+            return Promise(Value(ctx, JS_DupValue(ctx, value)));
+        }
+    }
+
+    PromiseResolver::PromiseResolver(JSContext* ctx) : _ctx(ctx)
+    {
+        _promise = JS_NewPromiseCapability(ctx, _funcs);
+        if (JS_IsException(_promise))
+        {
+            JS_FreeValue(ctx, JS_GetException(ctx));
+            _ctx = nullptr;
+            _promise = JS_UNDEFINED;
+            console::error("Failed to create promise");
+            QUICKJS_IF_EXCEPTIONS(throw Exception("Failed to create promise", ctx));
+        }
+    }
+
+    PromiseResolver::~PromiseResolver() { reset(); }
+
+    PromiseResolver::PromiseResolver(PromiseResolver&& other) noexcept
+        : _ctx(other._ctx), _promise(other._promise), _funcs{other._funcs[0], other._funcs[1]}, _settled(other._settled)
+    {
+        other._ctx = nullptr;
+        other._promise = JS_UNDEFINED;
+        other._funcs[0] = JS_UNDEFINED;
+        other._funcs[1] = JS_UNDEFINED;
+    }
+
+    PromiseResolver& PromiseResolver::operator=(PromiseResolver&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            _ctx = other._ctx;
+            _promise = other._promise;
+            _funcs[0] = other._funcs[0];
+            _funcs[1] = other._funcs[1];
+            _settled = other._settled;
+            other._ctx = nullptr;
+            other._promise = JS_UNDEFINED;
+            other._funcs[0] = JS_UNDEFINED;
+            other._funcs[1] = JS_UNDEFINED;
+        }
+        return *this;
+    }
+
+    Promise PromiseResolver::promise() const
+    {
+        return _ctx ? Promise(Value(_ctx, JS_DupValue(_ctx, _promise))) : Promise();
+    }
+
+    void PromiseResolver::resolve(const Value& value) { settle(0, value); }
+
+    void PromiseResolver::reject(const Value& reason) { settle(1, reason); }
+
+    void PromiseResolver::reject(const std::string& message)
+    {
+        if (!_ctx)
+        {
+            return;
+        }
+
+        Value error(_ctx, JS_NewError(_ctx));
+        JS_SetPropertyStr(_ctx, error._val, "message", JS_NewStringLen(_ctx, message.data(), message.size()));
+        settle(1, error);
+    }
+
+    void PromiseResolver::settle(int index, const Value& value)
+    {
+        if (!_ctx || _settled)
+        {
+            return;
+        }
+        _settled = true;
+
+        JSValueConst arg = value._ctx ? value._val : JS_UNDEFINED;
+        JSValue ret = JS_Call(_ctx, _funcs[index], JS_UNDEFINED, 1, &arg);
+        if (JS_IsException(ret))
+        {
+            detail::raise_call_exception(_ctx, "Failed to settle promise");
+            return;
+        }
+        JS_FreeValue(_ctx, ret);
+    }
+
+    void PromiseResolver::reset() noexcept
+    {
+        if (_ctx)
+        {
+            JS_FreeValue(_ctx, _funcs[0]);
+            JS_FreeValue(_ctx, _funcs[1]);
+            JS_FreeValue(_ctx, _promise);
+            _ctx = nullptr;
+        }
+        _promise = JS_UNDEFINED;
+        _funcs[0] = JS_UNDEFINED;
+        _funcs[1] = JS_UNDEFINED;
+        _settled = false;
+    }
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "../core/macros.hpp"
+#include "../detail/type_converter.hpp"
+#include "value.hpp"
+
+#include <quickjs.h>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace js
+{
+    class Context;
+
+    namespace detail
+    {
+        // run up to `max_jobs` pending jobs of the runtime (0 = until the queue is empty).
+        // A job that throws is reported and raised as js::Exception; returns the number of jobs run.
+        size_t run_pending_jobs(JSRuntime* rt, size_t max_jobs) QUICKJS_MAYBE_NOEXCEPT;
+    }
+
+    enum class PromiseState : int32_t
+    {
+        PENDING = JS_PROMISE_PENDING,
+        FULFILLED = JS_PROMISE_FULFILLED,
+        REJECTED = JS_PROMISE_REJECTED
+    };
+
+    // future-like handle to a JS Promise.
+    // The promise only makes progress while pending jobs run, either through Context::run_pending_jobs
+    // or by waiting on it here; all calls must happen on the thread that owns the runtime.
+    class Promise
+    {
+        friend class Context;
+        friend struct detail::TypeConverter<Promise>;
+
+    public:
+        Promise() = default;
+
+        // wrap a JS value, a value that is not a promise counts as already fulfilled with itself
+        explicit Promise(Value value) : _value(std::move(value)) {}
+
+        bool is_valid() const noexcept { return _value.is_valid(); }
+
+        PromiseState state() const noexcept;
+        bool is_settled() const noexcept { return state() != PromiseState::PENDING; }
+
+        // fulfilled value or rejection reason (undefined while pending)
+        Value result() const;
+
+        // run pending jobs until the promise settles, returns false when the job queue runs dry first
+        bool wait() const QUICKJS_MAYBE_NOEXCEPT;
+
+        // wait and return the fulfilled value, a rejection is raised as js::Exception
+        Value get() const QUICKJS_MAYBE_NOEXCEPT;
+
+        // wait and convert the fulfilled value
+        template <typename T>
+        T get_as() const
+        {
+            Value value = get();
+            return detail::TypeConverter<std::decay_t<T>>::from_js(value.context(), value.js_value());
+        }
+
+        // call `callback(result, rejected)` once the promise settles (from a pending job), right away for
+        // a value that is not a promise. If the promise is collected without settling, the callback is
+        // destroyed by the garbage collector without being called.
+        void on_settled(std::function<void(const Value& result, bool rejected)> callback) const QUICKJS_MAYBE_NOEXCEPT;
+
+        // the underlying JS promise
+        const Value& value() const noexcept { return _value; }
+
+    private:
+        // async global evals fulfill with a { value } record, `unwrap` makes result() return its value
+        Promise(Value value, bool unwrap) : _value(std::move(value)), _unwrap(unwrap) {}
+
+        // new reference to the underlying promise
+        JSValue dup_value() const noexcept;
+
+    private:
+        Value _value;
+        bool _unwrap{false};
+    };
+
+    // C++ side of a JS Promise created with JS_NewPromiseCapability.
+    // Hand promise() to JS and settle it later with resolve() or reject().
+    class PromiseResolver
+    {
+    public:
+        PromiseResolver() noexcept = default;
+        explicit PromiseResolver(JSContext* ctx);
+        ~PromiseResolver();
+
+        PromiseResolver(const PromiseResolver&) = delete;
+        PromiseResolver& operator=(const PromiseResolver&) = delete;
+
+        PromiseResolver(PromiseResolver&& other) noexcept;
+        PromiseResolver& operator=(PromiseResolver&& other) noexcept;
+
+        bool is_valid() const noexcept { return _ctx != nullptr; }
+
+        // only the first resolve()/reject() has an effect
+        bool is_settled() const noexcept { return _settled; }
+
+        Promise promise() const;
+
+        void resolve(const Value& value);
+        void reject(const Value& reason);
+
+        // reject with a new Error carrying `message`
+        void reject(const std::string& message);
+
+        template <typename T, typename = std::enable_if_t<!std::is_same_v<std::decay_t<T>, Value>>>
+        void resolve(T&& value)
+        {
+            if (!_ctx)
+            {
+                return;
+            }
+            settle(0, Value(_ctx, detail::TypeConverter<std::decay_t<T>>::to_js(_ctx, std::forward<T>(value))));
+        }
+
+    private:
+        void settle(int index, const Value& value);
+        void reset() noexcept;
+
+    private:
+        JSContext* _ctx{nullptr};
+        JSValue _promise{JS_UNDEFINED};
+        JSValue _funcs[2]{JS_UNDEFINED, JS_UNDEFINED};
+        bool _settled{false};
+    };
+
+    namespace detail
+    {
+        // js::Promise converter, hands the underlying promise to JS
+        template <>
+        struct TypeConverter<Promise>
+        {
+            static JSValue to_js(JSContext* ctx, const Promise& value);
+            static Promise from_js(JSContext* ctx, JSValueConst value);
+        };
+    }
+}
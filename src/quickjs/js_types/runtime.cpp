@@ -2,29 +2,157 @@
 #include "../core/utils.hpp"
 #include "../exception/exception.hpp"
 
+#include <algorithm>
+#include <atomic>
+
 namespace js
 {
+    namespace detail
+    {
+        BudgetScope::BudgetScope(JSContext* ctx, const ExecutionBudget& budget) noexcept
+        {
+            RuntimeData* data = runtime_data(ctx);
+            if (!data || budget.is_unlimited())
+            {
+                return;
+            }
+
+            _state = &data->interrupt;
+            _saved = *_state;
+
+            // a nested budget can only tighten the enclosing one: the earlier deadline and the smaller
+            // of its own tick limit and the ticks the enclosing budget has left
+            uint64_t tick_limit = budget.ticks;
+            if (_saved.active && _saved.tick_limit != 0)
+            {
+                uint64_t left = _saved.tick_limit > _saved.ticks ? _saved.tick_limit - _saved.ticks : 1;
+                tick_limit = tick_limit == 0 ? left : std::min(tick_limit, left);
+            }
+
+            if (!_saved.active)
+            {
+                _state->has_deadline = false;
+            }
+            _state->active = true;
+            _state->triggered = _saved.active && _saved.triggered;
+            _state->ticks = 0;
+            _state->tick_limit = tick_limit;
+            if (budget.time.count() > 0)
+            {
+                auto deadline = std::chrono::steady_clock::now() + budget.time;
+                if (!_saved.active || !_saved.has_deadline || deadline < _saved.deadline)
+                {
+                    _state->deadline = deadline;
+                }
+                _state->has_deadline = true;
+            }
+        }
+
+        BudgetScope::~BudgetScope()
+        {
+            if (_state)
+            {
+                // an enclosing budget keeps counting the ticks spent in this one
+                _saved.ticks += _state->ticks;
+                *_state = _saved;
+            }
+        }
+
+        ClassRegistry::ClassRegistry() noexcept
+        {
+            static std::atomic<uint64_t> next_serial{1};
+            _serial = next_serial.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        size_t ClassRegistry::next_type_index() noexcept
+        {
+            static std::atomic<size_t> next_index{0};
+            return next_index.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
     Runtime::Runtime() QUICKJS_MAYBE_NOEXCEPT : _runtime(JS_NewRuntime())
     {
-        js_std_init_handlers(_runtime);
+        init();
+    }
+
+    Runtime::Runtime(std::unique_ptr<Allocator> allocator) QUICKJS_MAYBE_NOEXCEPT
+        : _runtime(nullptr), _allocator(std::move(allocator))
+    {
+        if (_allocator)
+        {
+            _runtime = JS_NewRuntime2(&Allocator::malloc_functions(), _allocator.get());
+        }
+        init();
+    }
+
+    void Runtime::init() QUICKJS_MAYBE_NOEXCEPT
+    {
         if (!_runtime)
         {
             console::error("Failed to create runtime.");
             QUICKJS_IF_EXCEPTIONS(throw Exception("Failed to create runtime."));
+            return;
         }
+        js_std_init_handlers(_runtime);
+
+        _data = std::make_unique<detail::RuntimeData>();
+        JS_SetInterruptHandler(_runtime, &Runtime::interrupt_handler, _data.get());
     }
 
-    Runtime::~Runtime()
+    int Runtime::interrupt_handler(JSRuntime*, void* opaque)
+    {
+        // reading the clock on every poll is wasted work, sample it every few ticks instead
+        constexpr uint64_t CLOCK_STRIDE = 4;
+
+        detail::InterruptState& state = static_cast<detail::RuntimeData*>(opaque)->interrupt;
+        if (!state.active)
+        {
+            return 0;
+        }
+        if (state.triggered)
+        {
+            return 1;
+        }
+
+        ++state.ticks;
+        if (state.tick_limit != 0 && state.ticks >= state.tick_limit)
+        {
+            state.triggered = true;
+        }
+        else if (state.has_deadline && state.ticks % CLOCK_STRIDE == 0 && std::chrono::steady_clock::now() >= state.deadline)
+        {
+            state.triggered = true;
+        }
+        return state.triggered ? 1 : 0;
+    }
+
+    void Runtime::destroy() noexcept
     {
         if (_runtime)
         {
+            if (_data)
+            {
+                _data->atoms.clear(_runtime);
+                // pooled objects are finalized below, their slabs go back to the runtime before it is freed
+                _data->classes.drain_pools();
+            }
             js_std_free_handlers(_runtime);
             JS_FreeRuntime(_runtime);
             _runtime = nullptr;
         }
+        _data.reset();
+        // the allocator must outlive every block of the runtime
+        _allocator.reset();
+    }
+
+    Runtime::~Runtime()
+    {
+        destroy();
     }
 
-    Runtime::Runtime(Runtime&& other) noexcept : _runtime(other._runtime)
+    Runtime::Runtime(Runtime&& other) noexcept
+        : _runtime(other._runtime), _allocator(std::move(other._allocator)), _data(std::move(other._data))
     {
         other._runtime = nullptr;
     }
@@ -33,11 +161,10 @@ namespace js
     {
         if (this != &other)
         {
-            if (_runtime)
-            {
-                JS_FreeRuntime(_runtime);
-            }
+            destroy();
             _runtime = other._runtime;
+            _allocator = std::move(other._allocator);
+            _data = std::move(other._data);
             other._runtime = nullptr;
         }
         return *this;
@@ -45,5 +172,71 @@ namespace js
 
     bool Runtime::is_valid() const noexcept { return _runtime != nullptr; }
 
+    void Runtime::set_memory_limit(size_t limit) noexcept
+    {
+        // quickjs uses (size_t)-1 for "no limit"
+        if (_runtime) JS_SetMemoryLimit(_runtime, limit == 0 ? static_cast<size_t>(-1) : limit);
+    }
+
+    void Runtime::set_gc_threshold(size_t threshold) noexcept
+    {
+        if (_runtime) JS_SetGCThreshold(_runtime, threshold);
+    }
+
+    size_t Runtime::gc_threshold() const noexcept
+    {
+        return _runtime ? JS_GetGCThreshold(_runtime) : 0;
+    }
+
+    void Runtime::set_max_stack_size(size_t size) noexcept
+    {
+        if (_runtime) JS_SetMaxStackSize(_runtime, size);
+    }
+
+    void Runtime::run_gc() noexcept
+    {
+        if (_runtime) JS_RunGC(_runtime);
+    }
+
+    MemoryUsage Runtime::memory_usage() const noexcept
+    {
+        MemoryUsage usage;
+        if (!_runtime)
+        {
+            return usage;
+        }
+
+        JSMemoryUsage s{};
+        JS_ComputeMemoryUsage(_runtime, &s);
+
+        usage.heap_size = s.malloc_size;
+        usage.heap_limit = s.malloc_limit;
+        usage.allocation_count = s.malloc_count;
+        usage.memory_used_size = s.memory_used_size;
+        usage.memory_used_count = s.memory_used_count;
+        usage.atom_count = s.atom_count;
+        usage.atom_size = s.atom_size;
+        usage.string_count = s.str_count;
+        usage.string_size = s.str_size;
+        usage.object_count = s.obj_count;
+        usage.object_size = s.obj_size;
+        usage.property_count = s.prop_count;
+        usage.property_size = s.prop_size;
+        usage.shape_count = s.shape_count;
+        usage.shape_size = s.shape_size;
+        usage.js_function_count = s.js_func_count;
+        usage.js_function_size = s.js_func_size;
+        usage.bytecode_size = s.js_func_code_size;
+        usage.pc2line_count = s.js_func_pc2line_count;
+        usage.pc2line_size = s.js_func_pc2line_size;
+        usage.c_function_count = s.c_func_count;
+        usage.array_count = s.array_count;
+        usage.fast_array_count = s.fast_array_count;
+        usage.fast_array_elements = s.fast_array_elements;
+        usage.binary_object_count = s.binary_object_count;
+        usage.binary_object_size = s.binary_object_size;
+        return usage;
+    }
+
     JSRuntime* Runtime::get_runtime_handle() const noexcept { return _runtime; }
 }
@@ -0,0 +1,233 @@
+#include "runtime_pool.hpp"
+
+#include "../core/utils.hpp"
+
+#include <algorithm>
+
+namespace js
+{
+    RuntimePool::Lease::Lease(Lease&& other) noexcept : _pool(other._pool), _entry(other._entry)
+    {
+        other._pool = nullptr;
+        other._entry = nullptr;
+    }
+
+    RuntimePool::Lease& RuntimePool::Lease::operator=(Lease&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (_pool && _entry)
+            {
+                _pool->release(_entry);
+            }
+            _pool = other._pool;
+            _entry = other._entry;
+            other._pool = nullptr;
+            other._entry = nullptr;
+        }
+        return *this;
+    }
+
+    RuntimePool::Lease::~Lease()
+    {
+        if (_pool && _entry)
+        {
+            _pool->release(_entry);
+        }
+    }
+
+    Runtime& RuntimePool::Lease::runtime() const noexcept { return *_entry->runtime; }
+    Context& RuntimePool::Lease::context() const noexcept { return *_entry->context; }
+
+    RuntimePool::RuntimePool(RuntimePoolOptions options) QUICKJS_MAYBE_NOEXCEPT : _options(std::move(options))
+    {
+        if (_options.size == 0)
+        {
+            _options.size = 1;
+        }
+
+        _entries.reserve(_options.size);
+        _idle.reserve(_options.size);
+        for (size_t i = 0; i < _options.size; ++i)
+        {
+            auto entry = std::make_unique<Entry>();
+            create_pair(*entry);
+            _idle.push_back(entry.get());
+            _entries.push_back(std::move(entry));
+        }
+    }
+
+    RuntimePool::~RuntimePool()
+    {
+        QUICKJS_ASSERT(_idle.size() == _entries.size(), "RuntimePool destroyed while pairs are still leased\n");
+    }
+
+    void RuntimePool::create_pair(Entry& entry) QUICKJS_MAYBE_NOEXCEPT
+    {
+        // build the new pair first so a failure leaves the old one intact
+        auto runtime = _options.allocator ? std::make_unique<Runtime>(_options.allocator()) : std::make_unique<Runtime>();
+        auto context = std::make_unique<Context>(*runtime);
+        if (_options.setup)
+        {
+            _options.setup(*context);
+        }
+
+        entry.context = std::move(context);
+        entry.runtime = std::move(runtime);
+        entry.uses = 0;
+        entry.owner = std::this_thread::get_id();
+    }
+
+    RuntimePool::Entry* RuntimePool::take_idle_locked(std::thread::id self)
+    {
+        if (_idle.empty())
+        {
+            return nullptr;
+        }
+
+        // prefer a pair this thread used last, its stack limit is still valid
+        auto it = std::find_if(_idle.begin(), _idle.end(), [self](const Entry* e) { return e->owner == self; });
+        if (it == _idle.end())
+        {
+            it = _idle.end() - 1;
+        }
+
+        Entry* entry = *it;
+        *it = _idle.back();
+        _idle.pop_back();
+        return entry;
+    }
+
+    RuntimePool::Lease RuntimePool::make_lease(Entry* entry, std::thread::id self)
+    {
+        if (entry->owner != self)
+        {
+            // quickjs measures stack overflow against the stack of the thread that last ran it
+            JS_UpdateStackTop(entry->runtime->get_runtime_handle());
+            entry->owner = self;
+        }
+        ++entry->uses;
+        return Lease(this, entry);
+    }
+
+    RuntimePool::Lease RuntimePool::acquire()
+    {
+        const auto self = std::this_thread::get_id();
+        const auto start = std::chrono::steady_clock::now();
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        Entry* entry = take_idle_locked(self);
+        bool contended = entry == nullptr;
+        while (!entry)
+        {
+            _available.wait(lock);
+            entry = take_idle_locked(self);
+        }
+
+        ++_stats.leases;
+        if (contended)
+        {
+            auto waited = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+            ++_stats.contended_leases;
+            _stats.total_wait += waited;
+            _stats.max_wait = std::max(_stats.max_wait, waited);
+        }
+        lock.unlock();
+
+        return make_lease(entry, self);
+    }
+
+    std::optional<RuntimePool::Lease> RuntimePool::try_acquire()
+    {
+        const auto self = std::this_thread::get_id();
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        Entry* entry = take_idle_locked(self);
+        if (!entry)
+        {
+            return std::nullopt;
+        }
+        ++_stats.leases;
+        lock.unlock();
+
+        return make_lease(entry, self);
+    }
+
+    bool RuntimePool::should_recycle(const Entry& entry) const noexcept
+    {
+        if (_options.max_uses != 0 && entry.uses >= _options.max_uses)
+        {
+            return true;
+        }
+
+        if (_options.max_heap_bytes != 0)
+        {
+            return static_cast<size_t>(entry.runtime->memory_usage().heap_size) > _options.max_heap_bytes;
+        }
+
+        return false;
+    }
+
+    void RuntimePool::release(Entry* entry) noexcept
+    {
+        bool recycled = false;
+        bool recycle = _options.recycle_on_release;
+
+        if (!recycle && _options.reset)
+        {
+            try
+            {
+                _options.reset(*entry->context);
+            }
+            catch (const std::exception& e)
+            {
+                console::error("RuntimePool: failed to reset runtime, recycling it: %s", e.what());
+                recycle = true;
+            }
+            catch (...)
+            {
+                console::error("RuntimePool: failed to reset runtime, recycling it: unknown C++ exception");
+                recycle = true;
+            }
+        }
+
+        if (_options.gc_on_release && !recycle)
+        {
+            entry->runtime->run_gc();
+        }
+
+        if (recycle || should_recycle(*entry))
+        {
+            try
+            {
+                create_pair(*entry);
+                recycled = true;
+            }
+            catch (const std::exception& e)
+            {
+                // keep using the old pair rather than shrinking the pool
+                console::error("RuntimePool: failed to recycle runtime: %s", e.what());
+            }
+            catch (...)
+            {
+                console::error("RuntimePool: failed to recycle runtime: unknown C++ exception");
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _idle.push_back(entry);
+            if (recycled)
+            {
+                ++_stats.recycles;
+            }
+        }
+        _available.notify_one();
+    }
+
+    RuntimePoolStats RuntimePool::stats() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _stats;
+    }
+}
@@ -1,10 +1,36 @@
 #include "value.hpp"
 
 #include "../core/utils.hpp"
+#include "../exception/exception.hpp"
 #include "quickjs.h"
 
 namespace js
 {
+    namespace detail
+    {
+        std::string take_exception_message(JSContext* ctx, const char* what)
+        {
+            JSValue exception = JS_GetException(ctx);
+            std::string message = what;
+
+            JSString str(ctx, exception);
+            if (!str.empty())
+            {
+                message += ": ";
+                message += static_cast<std::string>(str);
+            }
+            JS_FreeValue(ctx, exception);
+            return message;
+        }
+
+        void raise_call_exception(JSContext* ctx, const char* what)
+        {
+            std::string message = take_exception_message(ctx, what);
+            console::error("%s", message.c_str());
+            QUICKJS_IF_EXCEPTIONS(throw Exception(message, ctx));
+        }
+    }
+
     Value::Value() : _ctx(nullptr), _val(JS_UNDEFINED) {}
 
     Value::Value(JSContext* ctx, JSValue val) : _ctx(ctx), _val(val) {}
@@ -78,8 +104,39 @@ namespace js
         }
 
         JSAtom atom = JS_NewAtom(_ctx, name);
-        JSValue result = JS_GetProperty(_ctx, _val, atom);
+        Value result = get_property(atom, name);
         JS_FreeAtom(_ctx, atom);
+        return result;
+    }
+
+    Value Value::operator[](const std::string& name) const
+    {
+        return (*this)[name.c_str()];
+    }
+
+    Value Value::operator[](const Atom& atom) const
+    {
+        if (!_ctx || !atom.is_valid())
+        {
+            return Value();
+        }
+        return get_property(atom.get(), "<atom>");
+    }
+
+    Value Value::operator[](const StaticAtom& atom) const
+    {
+        if (!_ctx)
+        {
+            return Value();
+        }
+
+        JSAtom cached = atom.cached(_ctx);
+        return cached != JS_ATOM_NULL ? get_property(cached, atom.name()) : (*this)[atom.name()];
+    }
+
+    Value Value::get_property(JSAtom atom, const char* name) const
+    {
+        JSValue result = JS_GetProperty(_ctx, _val, atom);
         if (!JS_IsException(result))
         {
             return Value(_ctx, result);
@@ -91,11 +148,6 @@ namespace js
         }
     }
 
-    Value Value::operator[](const std::string& name) const
-    {
-        return (*this)[name.c_str()];
-    }
-
     Value Value::operator[](uint32_t index) const
     {
         if (!is_array())
@@ -135,62 +187,86 @@ namespace js
     // function call
     Value Value::call(const std::vector<Value>& args) const
     {
-        if (!_ctx)
-        {
-            return Value();
-        }
+        return invoke(JS_UNDEFINED, args.data(), args.size());
+    }
 
-        std::vector<JSValue> js_args;
-        js_args.reserve(args.size());
-        for (const auto& arg : args)
-        {
-            js_args.push_back(arg._ctx ? JS_DupValue(_ctx, arg._val) : JS_UNDEFINED);
-        }
+    Value Value::call(std::initializer_list<Value> args) const
+    {
+        return invoke(JS_UNDEFINED, args.begin(), args.size());
+    }
 
-        JSValue result = JS_Call(_ctx, _val, JS_UNDEFINED, static_cast<int>(args.size()),
-                                 js_args.empty() ? nullptr : js_args.data());
+    Value Value::call(span<const Value> args) const
+    {
+        return invoke(JS_UNDEFINED, args.data(), args.size());
+    }
 
-        for (auto& v : js_args)
-        {
-            JS_FreeValue(_ctx, v);
-        }
+    Value Value::call_with_this(Value& this_val, const std::vector<Value>& args) const
+    {
+        return invoke(this_val._val, args.data(), args.size());
+    }
 
-        return Value(_ctx, result);
+    Value Value::call_with_this(Value& this_val, std::initializer_list<Value> args) const
+    {
+        return invoke(this_val._val, args.begin(), args.size());
     }
 
-    Value Value::call_with_this(Value& this_val, const std::vector<Value>& args) const
+    Value Value::call_with_this(Value& this_val, span<const Value> args) const
+    {
+        return invoke(this_val._val, args.data(), args.size());
+    }
+
+    Value Value::invoke(JSValueConst this_val, const Value* args, size_t count) const
     {
         if (!_ctx)
         {
             return Value();
         }
 
-        std::vector<JSValue> js_args;
-        js_args.reserve(args.size());
-        for (const auto& arg : args)
+        // JS_Call only borrows its arguments, so the handles are passed through as they are.
+        // Small argument lists stay on the stack.
+        constexpr size_t INLINE_ARGS = 8;
+        JSValueConst inline_args[INLINE_ARGS];
+        std::vector<JSValueConst> heap_args;
+        JSValueConst* js_args = inline_args;
+        if (count > INLINE_ARGS)
         {
-            js_args.push_back(arg._ctx ? JS_DupValue(_ctx, arg._val) : JS_UNDEFINED);
+            heap_args.resize(count);
+            js_args = heap_args.data();
         }
 
-        // clang-format off
-        JSValue result = JS_Call(
-            _ctx,
-            _val,
-            this_val._val,
-            static_cast<int>(args.size()),
-
-            js_args.empty() ? nullptr : js_args.data()
-        );
-        // clang-format on
-
-        for (auto& v : js_args)
+        for (size_t i = 0; i < count; ++i)
         {
-            JS_FreeValue(_ctx, v);
+            js_args[i] = args[i]._ctx ? args[i]._val : JS_UNDEFINED;
         }
 
+        JSValue result = JS_Call(_ctx, _val, this_val, static_cast<int>(count), count ? js_args : nullptr);
         return Value(_ctx, result);
     }
 
+    Value Value::call(const std::vector<Value>& args, const ExecutionBudget& budget) const
+    {
+        detail::BudgetScope scope(_ctx, budget);
+        return check_interrupted(call(args), scope);
+    }
+
+    Value Value::call_with_this(Value& this_val, const std::vector<Value>& args, const ExecutionBudget& budget) const
+    {
+        detail::BudgetScope scope(_ctx, budget);
+        return check_interrupted(call_with_this(this_val, args), scope);
+    }
+
+    Value Value::check_interrupted(Value result, const detail::BudgetScope& scope) const
+    {
+        if (scope.interrupted() && JS_IsException(result._val))
+        {
+            JS_FreeValue(_ctx, JS_GetException(_ctx));
+            console::warn("JS call interrupted, execution budget exhausted");
+            QUICKJS_IF_EXCEPTIONS(throw InterruptedException("Execution budget exhausted", _ctx));
+            return Value(_ctx, JS_UNDEFINED);
+        }
+        return result;
+    }
+
     JSValue Value::js_value() const { return _val; }
 
     JSValue Value::release() noexcept
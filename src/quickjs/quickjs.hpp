@@ -1,19 +1,30 @@
 #pragma once
 
 // core components
-#include "core/macros.hpp" // IWYU pragma: export
-#include "core/utils.hpp"  // IWYU pragma: export
+#include "core/allocator.hpp" // IWYU pragma: export
+#include "core/macros.hpp"    // IWYU pragma: export
+#include "core/utils.hpp"     // IWYU pragma: export
 
 // basic types
 #include "exception/exception.hpp" // IWYU pragma: export
+#include "js_types/atom.hpp"       // IWYU pragma: export
 #include "js_types/rest.hpp"       // IWYU pragma: export
+#include "js_types/span.hpp"       // IWYU pragma: export
 
 // detail implementations
 #include "detail/type_converter.hpp" // IWYU pragma: export
 #include "detail/type_traits.hpp"    // IWYU pragma: export
 
 // main components
-#include "js_types/context.hpp" // IWYU pragma: export
-#include "js_types/module.hpp"  // IWYU pragma: export
-#include "js_types/runtime.hpp" // IWYU pragma: export
-#include "js_types/value.hpp"   // IWYU pragma: export
+#include "js_types/bundle.hpp"         // IWYU pragma: export
+#include "js_types/bytecode_cache.hpp" // IWYU pragma: export
+#include "js_types/context.hpp"        // IWYU pragma: export
+#include "js_types/event_loop.hpp"     // IWYU pragma: export
+#include "js_types/executor.hpp"       // IWYU pragma: export
+#include "js_types/function.hpp"       // IWYU pragma: export
+#include "js_types/module.hpp"         // IWYU pragma: export
+#include "js_types/promise.hpp"        // IWYU pragma: export
+#include "js_types/runtime.hpp"        // IWYU pragma: export
+#include "js_types/runtime_pool.hpp"   // IWYU pragma: export
+#include "js_types/task.hpp"           // IWYU pragma: export
+#include "js_types/value.hpp"          // IWYU pragma: export
@@ -0,0 +1,108 @@
+// qjsbundle - ahead-of-time compiler for js::Context::load_bundle
+//
+// Usage:
+//   qjsbundle -o <output> [--script | --module] <file>...
+//
+// Files are compiled in the given order. "--script" (the default) and "--module" switch the
+// kind of the files that follow; modules are registered under their path as given on the
+// command line, so list imported modules before the modules importing them.
+
+#include <quickjs/quickjs.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+static void print_usage()
+{
+    std::cerr << "usage: qjsbundle -o <output> [--script | --module] <file>..." << std::endl;
+}
+
+static bool read_file(const std::string& path, std::string& content)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        return false;
+    }
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    content = ss.str();
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    std::string output;
+    bool module_mode = false;
+
+    js::Runtime runtime;
+    js::Context context(runtime);
+    js::BundleWriter writer(context);
+
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "-o")
+            {
+                if (++i >= argc)
+                {
+                    print_usage();
+                    return 1;
+                }
+                output = argv[i];
+            }
+            else if (arg == "--script")
+            {
+                module_mode = false;
+            }
+            else if (arg == "--module")
+            {
+                module_mode = true;
+            }
+            else if (arg == "-h" || arg == "--help")
+            {
+                print_usage();
+                return 0;
+            }
+            else
+            {
+                std::string source;
+                if (!read_file(arg, source))
+                {
+                    std::cerr << "qjsbundle: cannot read " << arg << std::endl;
+                    return 1;
+                }
+
+                bool added = module_mode ? writer.add_module(arg, source) : writer.add_script(arg, source);
+                if (!added)
+                {
+                    std::cerr << "qjsbundle: failed to compile " << arg << std::endl;
+                    return 1;
+                }
+            }
+        }
+    }
+    catch (const js::Exception& e)
+    {
+        std::cerr << "qjsbundle: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (output.empty() || writer.size() == 0)
+    {
+        print_usage();
+        return 1;
+    }
+
+    if (!writer.write(output))
+    {
+        return 1;
+    }
+
+    std::cout << "qjsbundle: wrote " << writer.size() << " entries to " << output << std::endl;
+    return 0;
+}
@@ -19,5 +19,31 @@ target("quickjs_wrapper")
     add_includedirs("src", {public = false})
     set_targetdir("lib/$(arch)-$(mode)")
 
+    if is_plat("linux") then
+        add_syslinks("pthread", {public = true})
+    end
+
+    add_packages("quickjs")
+target_end()
+
+-- ahead-of-time bytecode bundle compiler (see Context::load_bundle)
+target("qjsbundle")
+    set_kind("binary")
+    set_default(false)
+    add_files("tools/qjsbundle/main.cpp")
+    add_deps("quickjs_wrapper")
+    set_targetdir("bin/$(arch)-$(mode)")
+
+    add_packages("quickjs")
+target_end()
+
+-- binding layer microbenchmarks, results are written as JSON (xmake run bench --out=results.json)
+target("bench")
+    set_kind("binary")
+    set_default(false)
+    add_files("bench/main.cpp")
+    add_deps("quickjs_wrapper")
+    set_targetdir("bin/$(arch)-$(mode)")
+
     add_packages("quickjs")
-target_end()
\ No newline at end of file
+target_end()